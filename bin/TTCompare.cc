@@ -0,0 +1,135 @@
+/*
+ * Differential test of the analysis: run a reference and a candidate configuration on the same captured events
+ * (see the analyzer `captureFile` parameter), and compare all their outputs field by field (see OutputsComparison.h).
+ *
+ * Usage: ttCompare [--tolerance T] [--examples N] [--reference key=value ...] [--candidate key=value ...] capture.bin [capture2.bin ...]
+ *
+ * Both configurations start from the default settings. The keys are the AnalysisConfig members which select an implementation
+ * or change the precision: neutrinosSolverPrecheck, ttbarMaxSolutions, DRMantissaBits, DEtaMantissaBits, DPhiMantissaBits,
+ * maxDiLepDiJets, ttbarMaxDiLepDiJets, maxCandidatesPerCombination, stageThreads, ttbarSmearingSamples, ttbarSmearingSeed
+ * and compactTTBar (0 or 1).
+ * A new implementation is tested by selecting it for the candidate only.
+ * The telemetry summaries of both configurations are printed after the report, e.g. to compare their neutrinos solver calls.
+ *
+ * Exits with 0 if the outputs agree for all events, 2 if they differ.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/AnalysisCore.h>
+#include <cp3_llbb/TTAnalysis/interface/EventCapture.h>
+#include <cp3_llbb/TTAnalysis/interface/OutputsComparison.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace TTAnalysis;
+
+namespace {
+
+  void setOption(AnalysisConfig& config, const std::string& option) {
+
+    const size_t separator = option.find('=');
+    if (separator == std::string::npos)
+      throw std::invalid_argument("Expected key=value, got '" + option + "'");
+
+    const std::string key = option.substr(0, separator);
+    const std::string value = option.substr(separator + 1);
+    const unsigned long number = std::strtoul(value.c_str(), nullptr, 10);
+
+    if (key == "neutrinosSolverPrecheck") {
+      config.neutrinosSolverPrecheck = number;
+    } else if (key == "ttbarMaxSolutions") {
+      config.ttbarMaxSolutions = number;
+    } else if (key == "DRMantissaBits") {
+      config.DRMantissaBits = number;
+    } else if (key == "DEtaMantissaBits") {
+      config.DEtaMantissaBits = number;
+    } else if (key == "DPhiMantissaBits") {
+      config.DPhiMantissaBits = number;
+    } else if (key == "maxDiLepDiJets") {
+      config.maxDiLepDiJets = number;
+    } else if (key == "ttbarMaxDiLepDiJets") {
+      config.ttbarMaxDiLepDiJets = number;
+    } else if (key == "maxCandidatesPerCombination") {
+      config.maxCandidatesPerCombination = number;
+    } else if (key == "ttbarSmearingSamples") {
+      config.ttbarSmearingSamples = number;
+    } else if (key == "ttbarSmearingSeed") {
+      config.ttbarSmearingSeed = number;
+    } else if (key == "stageThreads") {
+      config.stageThreads = number;
+    } else if (key == "compactTTBar") {
+      // As the analyzer: only one of `ttbar` and `ttbar_compact` is filled
+      config.disabledBranches.erase("ttbar");
+      config.disabledBranches.erase("ttbar_compact");
+      config.disabledBranches.insert(number ? "ttbar" : "ttbar_compact");
+    } else {
+      throw std::invalid_argument("Unknown option: " + key);
+    }
+  }
+
+}
+
+int main(int argc, char** argv) {
+
+  AnalysisConfig reference, candidate;
+  reference.disabledBranches.insert("ttbar_compact");
+  candidate.disabledBranches.insert("ttbar_compact");
+
+  std::vector<std::string> files;
+  double tolerance = 1e-5;
+  size_t examples = 5;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--tolerance" && i + 1 < argc)
+        tolerance = std::strtod(argv[++i], nullptr);
+      else if (arg == "--examples" && i + 1 < argc)
+        examples = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--reference" && i + 1 < argc)
+        setOption(reference, argv[++i]);
+      else if (arg == "--candidate" && i + 1 < argc)
+        setOption(candidate, argv[++i]);
+      else
+        files.push_back(arg);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (files.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--tolerance T] [--examples N] [--reference key=value ...] [--candidate key=value ...] capture.bin [capture2.bin ...]" << std::endl;
+    return 1;
+  }
+
+  AnalysisCore reference_core(reference);
+  AnalysisCore candidate_core(candidate);
+  OutputsComparison comparison(tolerance, examples);
+
+  try {
+    for (const std::string& file: files) {
+      EventCaptureReader reader(file);
+      EventInputs inputs;
+      while (reader.read(inputs)) {
+        reference_core.analyze(inputs);
+        candidate_core.analyze(inputs);
+        comparison.compare(inputs.run, inputs.lumi, inputs.event, reference_core, candidate_core);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  comparison.report(std::cout);
+
+  std::cout << "Reference:" << std::endl;
+  reference_core.telemetrySummary().print(std::cout);
+  std::cout << "Candidate:" << std::endl;
+  candidate_core.telemetrySummary().print(std::cout);
+
+  return comparison.identical() ? 0 : 2;
+}
@@ -0,0 +1,91 @@
+/*
+ * Replay events captured by the analyzer (`captureFile` parameter) without the framework.
+ *
+ * Usage: ttReplay [--repeat N] [--stage-threads T] capture.bin [capture2.bin ...]
+ *
+ * The events are loaded in memory, then run N times (default 1) through the analysis with its default settings,
+ * except for the number of threads running the stages of each event (AnalysisConfig::stageThreads, default 0).
+ * The loading and per-event processing times are reported, together with the preselection and telemetry summaries.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/AnalysisCore.h>
+#include <cp3_llbb/TTAnalysis/interface/EventCapture.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace TTAnalysis;
+
+int main(int argc, char** argv) {
+
+  std::vector<std::string> files;
+  size_t repeat = 1;
+  AnalysisConfig config;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--repeat" && i + 1 < argc)
+      repeat = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--stage-threads" && i + 1 < argc)
+      config.stageThreads = std::strtoul(argv[++i], nullptr, 10);
+    else
+      files.push_back(arg);
+  }
+
+  if (files.empty() || repeat == 0) {
+    std::cerr << "Usage: " << argv[0] << " [--repeat N] [--stage-threads T] capture.bin [capture2.bin ...]" << std::endl;
+    return 1;
+  }
+
+  std::vector<EventInputs> events;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    for (const std::string& file: files) {
+      EventCaptureReader reader(file);
+      EventInputs inputs;
+      while (reader.read(inputs))
+        events.push_back(inputs);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  size_t electrons = 0, muons = 0, jets = 0, gen_particles = 0;
+  for (const EventInputs& inputs: events) {
+    electrons += inputs.electrons.p4.size();
+    muons += inputs.muons.p4.size();
+    jets += inputs.jets.p4.size();
+    gen_particles += inputs.genParticles.pruned_p4.size();
+  }
+
+  std::cout << events.size() << " events loaded from " << files.size() << " file(s) in " << elapsed.count() << " s" << std::endl;
+  if (events.empty())
+    return 0;
+
+  std::cout << "Average multiplicities: " << double(electrons) / events.size() << " electrons, " << double(muons) / events.size() << " muons, "
+    << double(jets) / events.size() << " jets, " << double(gen_particles) / events.size() << " gen particles" << std::endl;
+
+  AnalysisCore core(config);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t pass = 0; pass < repeat; pass++) {
+    for (const EventInputs& inputs: events)
+      core.analyze(inputs);
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+
+  const size_t processed = repeat * events.size();
+  std::cout << processed << " events analyzed in " << elapsed.count() << " s (" << 1e6 * elapsed.count() / processed << " us/event)" << std::endl;
+
+  std::cout << "Preselection summary:" << std::endl;
+  for (const Preselection::Stage& stage: Preselection::it)
+    std::cout << "\t" << Preselection::map.at(stage) << ": " << core.preselectionCounters()[stage] << std::endl;
+
+  core.telemetrySummary().print(std::cout);
+
+  return 0;
+}
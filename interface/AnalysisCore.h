@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+#include <cp3_llbb/TTAnalysis/interface/EventInputs.h>
+#include <cp3_llbb/TTAnalysis/interface/EventOutputs.h>
+#include <cp3_llbb/TTAnalysis/interface/GenAncestry.h>
+#include <cp3_llbb/TTAnalysis/interface/NeutrinosSolver.h>
+#include <cp3_llbb/TTAnalysis/interface/TTBarSmearing.h>
+#include <cp3_llbb/TTAnalysis/interface/TaskGraph.h>
+#include <cp3_llbb/TTAnalysis/interface/TelemetrySummary.h>
+
+namespace TTAnalysis {
+
+  // Settings of the analysis. Defaults are the ones of the analyzer parameters of the same name.
+  struct AnalysisConfig {
+    float electronPtCut = 20, electronEtaCut = 2.5;
+
+    float muonPtCut = 20, muonEtaCut = 2.4, muonLooseIsoCut = 0.2, muonTightIsoCut = 0.12;
+
+    float jetPtCut = 30, jetEtaCut = 2.5, bJetEtaCut = 2.4, jetPUID = std::numeric_limits<float>::min(), jetDRleptonCut = 0.3;
+    JetID::JetID jetID = JetID::L;
+    float jetCSVv2L = 0.605, jetCSVv2M = 0.89, jetCSVv2T = 0.97;
+
+    float hltDRCut = std::numeric_limits<float>::max(), hltDPtCut = std::numeric_limits<float>::max();
+
+    size_t ttbarMaxSolutions = 0;
+
+    // Resolution-smeared ttbar reconstruction (see TTBarSmearing), with this number of samples per candidate (0: disabled).
+    // The samples are drawn from a random stream seeded by `ttbarSmearingSeed`, the event and the candidate objects.
+    size_t ttbarSmearingSamples = 0;
+    float ttbarSmearingLeptonResolution = 0.02, ttbarSmearingJetResolution = 0.1, ttbarSmearingMetResolution = 10;
+    uint64_t ttbarSmearingSeed = 0;
+
+    size_t preselectionMinLeptons = 0, preselectionMinJets = 0;
+
+    // Number of candidates kept in each list of b-jet pairs (diBJets_DRCut_BWP_*, diLepDiBJets_DRCut_BWP_*, diLepDiBJetsMet_DRCut_BWP_*),
+    // by decreasing CSVv2 or Pt (0: all of them). The ttbar system is only reconstructed for the kept candidates.
+    size_t maxCandidatesPerCombination = 0;
+
+    // Caps on the size of the combinatorics (0: disabled). Above them, the corresponding stages are skipped (see Degradation).
+    size_t maxDiLepDiJets = 0, ttbarMaxDiLepDiJets = 0;
+
+    uint8_t DRMantissaBits = 23, DEtaMantissaBits = 23, DPhiMantissaBits = 23;
+
+    bool neutrinosSolverPrecheck = true; // Reject the configurations above the m_lb endpoint before solving, and flag them in `ttbar_rejected` (see NeutrinosSolver::Status)
+
+    // Threads running the independent stages of each event concurrently, besides the calling one (0: the stages run sequentially)
+    size_t stageThreads = 0;
+
+    // Outputs (as named in EventOutputsList.h) which are not needed: computations only feeding them are skipped
+    std::set<std::string> disabledBranches;
+  };
+
+  /*
+   * Selection, combinatorics and ttbar reconstruction, independent of the framework:
+   * reads plain arrays (EventInputs) and fills the EventOutputs it derives from.
+   * One instance processes one event at a time; it keeps its allocations across events.
+   * The independent stages of an event can run concurrently on the instance's own threads (see AnalysisConfig::stageThreads).
+   */
+  class AnalysisCore: public EventOutputs {
+    public:
+      explicit AnalysisCore(const AnalysisConfig& config);
+
+      void analyze(const EventInputs& inputs);
+
+      // Redo the jet-dependent stages of the last analyzed event with other jets and MET, e.g. a JEC/JER variation.
+      // The leptons, trigger matching and gen-level information are reused: only the TT_JET_OUTPUT outputs change.
+      // The preselection counters only count the nominal events.
+      void analyzeJetVariation(const JetsInputs& jets, const myLorentzVector& met_p4);
+
+      bool isBranchEnabled(const std::string& name) const {
+        return !m_config.disabledBranches.count(name);
+      }
+
+      // Number of events having reached each preselection stage
+      const std::array<uint64_t, Preselection::Count>& preselectionCounters() const {
+        return m_preselection_counters;
+      }
+
+      // Number of events for which each stage has been skipped because of the caps
+      const std::array<uint64_t, Degradation::Count>& degradationCounters() const {
+        return m_degradation_counters;
+      }
+
+      // Distributions of the `telemetry` counts of the nominal events
+      const TelemetrySummary& telemetrySummary() const {
+        return m_telemetry_summary;
+      }
+
+    private:
+      const AnalysisConfig m_config;
+
+      // Masses used for the neutrinos reconstruction, for data and simulation respectively
+      const NeutrinosSolver m_data_neutrinos_solver;
+      const NeutrinosSolver m_mc_neutrinos_solver;
+
+      // Stages which are only needed for some optional outputs
+      struct {
+        bool diLepDiJets, diLepDiJetsLists, diLepDiJetsAngles;
+        bool diLepDiJetsMet, diLepDiJetsMetLists, diLepDiJetsMetAngles;
+        bool ttbar, ttbarCompact, ttbarRejected, ttbarSmeared;
+      } m_compute;
+
+      std::array<uint64_t, Preselection::Count> m_preselection_counters;
+      std::array<uint64_t, Degradation::Count> m_degradation_counters;
+      TelemetrySummary m_telemetry_summary;
+
+      // State of the current event shared by its jet variations
+      bool m_isRealData = false;
+      bool m_passedLeptons = false; // The event passes the lepton preselection
+      bool m_matchGenLeptons = false; // The gen-level ttbar decay has leptons, which can be matched to the selected ones
+      bool m_matchGenJets = false; // The gen-level ttbar decay is known, and the b quarks can be matched to the jets
+      uint64_t m_event_seed = 0; // Seed of the random streams of the event
+
+      // State of the current jet variation
+      bool m_passedJets = false; // The event passes the jet preselection
+      bool m_reconstructTTBar = false; // The ttbar reconstruction is needed, and within the caps
+
+      // Stages of analyze() and analyzeJets(), reading the inputs being analyzed
+      std::unique_ptr<TaskPool> m_pool; // Null if the stages run sequentially
+      TaskGraph m_event_stages;
+      TaskGraph m_jet_stages;
+      const EventInputs* m_event_inputs = nullptr;
+      const JetsInputs* m_jets_inputs = nullptr;
+      myLorentzVector m_met_p4;
+
+      bool passJetID(const JetsInputs& jets, uint16_t index) const;
+
+      void buildStages();
+      void analyzeJets(const JetsInputs& jets, const myLorentzVector& met_p4);
+      void selectLeptons(const ElectronsInputs& electrons, const MuonsInputs& muons);
+      void buildDiLeptons();
+      void preselectJets(const JetsInputs& jets);
+      void buildJetCombinatorics(const JetsInputs& jets, const myLorentzVector& met_p4);
+      void selectJets(const JetsInputs& jets);
+      void buildDiJets(const JetsInputs& jets);
+      void buildDiLepDiJets(const JetsInputs& jets);
+      void buildDiLepDiJetsMet(const JetsInputs& jets, const myLorentzVector& met_p4);
+      void reconstructTTBar(const myLorentzVector& met_p4, const NeutrinosSolver& solver);
+      void reconstructTTBarCandidate(uint16_t idx, const NeutrinosSolver::LorentzVector& met_p4, const NeutrinosSolver& solver);
+      void countNeutrinosCall(size_t solutions, NeutrinosSolver::Status status);
+      void matchTrigger(const HLTInputs& hlt);
+      void fillDiLeptonsSummary();
+      void fillGenInfo(const GenParticlesInputs& gen_particles);
+      void matchGenLeptons();
+      void matchGenJets();
+      bool quantizeAngularVariables() const;
+      float quantizedDR(float value) const;
+      float quantizedDEta(float value) const;
+      float quantizedDPhi(float value) const;
+      void quantizeLeptonAngularVariables();
+      void quantizeJetAngularVariables();
+
+      // Per-event scratch, kept across events to reuse its allocations
+      GenAncestry m_gen_ancestry;
+      std::vector<bool> m_hlt_tried_matching; // Indexed as `leptons`: true if a match to an online object has already been tried for this lepton
+      std::vector<float> m_gen_b_jet_deltaR; // DeltaR of the gen b quarks to each jet of `selJets`, see matchGenJets()
+      // Cartesian four-vectors of the objects, indexed as their collections: the composite objects are built from their sums (see BaseObject)
+      std::vector<myCartesianVector> m_leptons_cartesian, m_selJets_cartesian, m_diLeptons_cartesian, m_diJets_cartesian, m_diLepDiJets_cartesian;
+      // ttbar solution of one candidate, before building its TTBar: sorted by mtt, then in the order of the solver
+      struct TTBarSolution {
+        float mtt;
+        uint8_t index;
+        NeutrinosSolver::LorentzVector top1_p4, top2_p4;
+
+        bool operator<(const TTBarSolution& other) const {
+          return mtt < other.mtt || (mtt == other.mtt && index < other.index);
+        }
+      };
+      std::vector<TTBarSolution> m_ttbar_order; // Solutions of the candidate being reconstructed
+      std::unique_ptr<TTBarSmearing> m_ttbar_smearing; // Null if the smeared reconstruction is disabled
+      // Indexed as `diLepDiJetsMet`: reconstruction of the candidates, computed once per jet variation and copied to each of their combinations
+      std::vector<std::vector<TTBar>> m_ttbar_sols;
+      std::vector<uint8_t> m_ttbar_rejected;
+      std::vector<TTBarSmeared> m_ttbar_smeared;
+      std::vector<bool> m_ttbar_done;
+  };
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace TTAnalysis {
+
+  /*
+   * Read-only array of the analysis inputs. It is either a view of an array owned by someone else (`bind`),
+   * e.g. a producer branch, and is then only valid as long as this array is not modified (for the analyzer: the current event),
+   * or a copy held by the column itself (`assign`, `push_back`, `swap`).
+   * Views avoid copying the producer arrays for each event: only the arrays needing a conversion are copied.
+   */
+  template<typename T>
+  class Column {
+    public:
+      Column() {}
+
+      // A copy of a view is a view of the same array, a copy of an owned column owns a copy of the elements
+      Column(const Column& other): m_storage(other.m_storage) {
+        copyFrom(other);
+      }
+
+      Column& operator=(const Column& other) {
+        m_storage = other.m_storage;
+        copyFrom(other);
+        return *this;
+      }
+
+      // Reference `array` without copying it
+      void bind(const std::vector<T>& array) {
+        m_storage.clear();
+        m_owned = false;
+        m_data = array.data();
+        m_size = array.size();
+      }
+
+      // Arrays of another type (e.g. std::vector<bool> flags) cannot be referenced: they are converted into the column's own storage
+      template<typename U>
+      void bind(const std::vector<U>& array) {
+        assign(array.begin(), array.end());
+      }
+
+      template<typename Iterator>
+      void assign(Iterator first, Iterator last) {
+        m_storage.assign(first, last);
+        own();
+      }
+
+      void clear() {
+        m_storage.clear();
+        own();
+      }
+
+      void push_back(const T& value) {
+        m_storage.push_back(value);
+        own();
+      }
+
+      // Exchange the column's own storage with `array`, e.g. to fill it in place
+      void swap(std::vector<T>& array) {
+        m_storage.swap(array);
+        own();
+      }
+
+      size_t size() const {
+        return m_size;
+      }
+      bool empty() const {
+        return m_size == 0;
+      }
+      const T& operator[](size_t index) const {
+        return m_data[index];
+      }
+      const T* data() const {
+        return m_data;
+      }
+      const T* begin() const {
+        return m_data;
+      }
+      const T* end() const {
+        return m_data + m_size;
+      }
+
+    private:
+      std::vector<T> m_storage; // Only used if the column owns its elements
+      bool m_owned = true;
+      const T* m_data = nullptr;
+      size_t m_size = 0;
+
+      void own() {
+        m_owned = true;
+        m_data = m_storage.data();
+        m_size = m_storage.size();
+      }
+
+      void copyFrom(const Column& other) {
+        if(other.m_owned){
+          own();
+        } else {
+          m_owned = false;
+          m_data = other.m_data;
+          m_size = other.m_size;
+        }
+      }
+  };
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <cp3_llbb/TTAnalysis/interface/EventInputs.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Binary capture of the analyzer inputs, to replay real events without the framework.
+   *
+   * The file starts with a header (magic string and format version), followed by one record per event.
+   * Each record is prefixed by its size in bytes, and holds the EventInputs fields in declaration order:
+   * arrays are stored as their length (uint32) followed by their elements, four-vectors as (Pt, Eta, Phi, E) floats.
+   * Numbers use the native byte order: files are meant to be produced and read on the same kind of machine.
+   */
+
+  class EventCaptureWriter {
+    public:
+      explicit EventCaptureWriter(const std::string& path);
+
+      // Writer of `path` shared by all the callers asking for it, e.g. the analyzer instances of the different streams:
+      // the file is only created once, and their events are all written to it. It is closed when the last caller releases it.
+      static std::shared_ptr<EventCaptureWriter> shared(const std::string& path);
+
+      // Can be called concurrently: the records are serialized in parallel, and written one after the other
+      void write(const EventInputs& inputs);
+
+      uint64_t events() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events;
+      }
+
+    private:
+      mutable std::mutex m_mutex;
+      std::ofstream m_file;
+      uint64_t m_events = 0;
+  };
+
+  class EventCaptureReader {
+    public:
+      explicit EventCaptureReader(const std::string& path);
+
+      // Read the next event into `inputs`. Returns false at the end of the file.
+      bool read(EventInputs& inputs);
+
+    private:
+      std::ifstream m_file;
+      std::string m_path;
+      std::string m_buffer;
+  };
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+#include <cp3_llbb/TTAnalysis/interface/Column.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Everything the analyzer reads from the producers for one event, as plain arrays.
+   * The configured electron IDs and b-tagging discriminant are already resolved, so that
+   * these inputs don't depend on the producers or on the analyzer configuration anymore.
+   * Flags are stored as uint8_t to keep the arrays contiguous.
+   * The arrays are Columns: the analyzer references the producer arrays instead of copying them when their types match.
+   */
+
+  struct ElectronsInputs {
+    Column<myLorentzVector> p4;
+    Column<int8_t> charge;
+    Column<uint8_t> vetoID, looseID, mediumID, tightID; // `electron*IDName` of the analyzer
+    Column<float> relativeIsoR03_withEA;
+  };
+
+  struct MuonsInputs {
+    Column<myLorentzVector> p4;
+    Column<int8_t> charge;
+    Column<uint8_t> isLoose, isMedium, isTight;
+    Column<float> relativeIsoR04_deltaBeta;
+  };
+
+  struct JetsInputs {
+    Column<myLorentzVector> p4;
+    Column<uint8_t> passLooseID, passTightID, passTightLeptonVetoID;
+    Column<float> CSVv2; // `jetCSVv2Name` discriminant of the analyzer
+  };
+
+  struct HLTInputs {
+    bool exists = false; // False if there is no HLT producer
+    Column<std::string> paths;
+    Column<myLorentzVector> object_p4;
+    Column<int32_t> object_pdg_id;
+  };
+
+  struct GenParticlesInputs {
+    Column<myLorentzVector> pruned_p4;
+    Column<int16_t> pruned_pdg_id;
+    Column<uint16_t> pruned_status_flags;
+    Column<std::vector<uint16_t>> pruned_mothers_index;
+  };
+
+  struct EventInputs {
+    uint32_t run = 0;
+    uint32_t lumi = 0;
+    uint64_t event = 0;
+    bool isRealData = false;
+
+    ElectronsInputs electrons;
+    MuonsInputs muons;
+    JetsInputs jets;
+    myLorentzVector met_p4;
+    HLTInputs hlt;
+    GenParticlesInputs genParticles; // Empty for data
+  };
+
+}
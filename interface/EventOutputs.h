@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+
+namespace TTAnalysis {
+
+  // Everything computed by the analysis for one event (see EventOutputsList.h for the stored collections)
+  struct EventOutputs {
+
+#define TT_OUTPUT(NAME, ...) __VA_ARGS__ NAME{};
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    // Leading DiLepton for each ID/Iso combination (indexed as `diLeptons_IDIso`), filled once per event for the categories. Not stored in the tree.
+    std::array<DiLeptonSummary, LepID::Count * LepIso::Count * LepID::Count * LepIso::Count> diLeptons_summary;
+    // Bit `1 << flavour` is set if the leading DiLepton of at least one ID/Iso combination has this DiLepFlavour
+    uint8_t diLeptons_flavours = 0;
+
+    // Reset the outputs before a new event. The vectors are only cleared, to reuse their allocations.
+    void clear();
+    // Same, only for the outputs depending on the jets (TT_JET_OUTPUT entries)
+    void clearJetOutputs();
+  };
+
+}
@@ -0,0 +1,133 @@
+// No include guard: this file is included several times.
+//
+// Per-event outputs of the analysis, as TT_OUTPUT(name, type) entries.
+// Define TT_OUTPUT before including this file: EventOutputs.h declares the members of TTAnalysis::EventOutputs,
+// and the analyzer declares one branch of the same name for each entry.
+//
+// The outputs depending on the jets or the MET are TT_JET_OUTPUT entries: they are recomputed for each jet systematic variation.
+// If TT_JET_OUTPUT is not defined, they are expanded as TT_OUTPUT.
+
+#ifndef TT_JET_OUTPUT
+#define TT_JET_OUTPUT TT_OUTPUT
+#define TT_JET_OUTPUT_IS_TT_OUTPUT
+#endif
+
+TT_JET_OUTPUT(preselection, uint8_t) // Stage at which the event has been rejected by the preselection. Can take any values from the Preselection::Stage enum
+TT_JET_OUTPUT(degraded, uint8_t) // Bit `1 << stage` is set for each Degradation::Stage skipped because the event exceeds the configured collection sizes
+TT_JET_OUTPUT(telemetry, TTAnalysis::Telemetry) // Multiplicities and neutrinos solver calls of the event
+
+TT_OUTPUT(electrons_IDIso, std::vector<std::vector<uint16_t>>)
+TT_OUTPUT(muons_IDIso, std::vector<std::vector<uint16_t>>)
+
+TT_OUTPUT(leptons, std::vector<TTAnalysis::Lepton>)
+TT_OUTPUT(leptons_IDIso, std::vector<std::vector<uint16_t>>)
+
+TT_OUTPUT(diLeptons, std::vector<TTAnalysis::DiLepton>)
+TT_OUTPUT(diLeptons_IDIso, std::vector<std::vector<uint16_t>>)
+
+TT_JET_OUTPUT(selJets, std::vector<TTAnalysis::Jet>)
+TT_JET_OUTPUT(selJets_selID, std::vector<uint16_t>)
+// ex.: selectedJets_..._DRCut[X][0] is the highest Pt selected jet with minDRjl>0.3 taking into account ID/Iso-X Leptons
+TT_JET_OUTPUT(selJets_selID_DRCut, std::vector<std::vector<uint16_t>>)
+// ex.: selectedBJets_..._PtOrdered[X][0] is the highest Pt selected jet with minDRjl>0.3 taking into account ID/Iso/Btag-X combination
+TT_JET_OUTPUT(selBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>)
+TT_JET_OUTPUT(selBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>)
+
+TT_JET_OUTPUT(diJets, std::vector<TTAnalysis::DiJet>)
+// ex.: diJets_DRCut[X][0] is first diJet with minDRjl>0.3 taking into account ID/Iso-X Leptons
+TT_JET_OUTPUT(diJets_DRCut, std::vector<std::vector<uint16_t>>)
+// ex.: diBJets_..._CSVv2Ordered[X][0] is the b-jet pair with highest CSVv2 values and with minDRjl>0.3 taking into account the leptonID/Iso/Btag-X combination
+TT_JET_OUTPUT(diBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>)
+TT_JET_OUTPUT(diBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>)
+
+// For all the following: indices are combinations of LeptonID/LeptonIso/(B-tagging working point)
+
+TT_JET_OUTPUT(diLepDiJets, std::vector<TTAnalysis::DiLepDiJet>)
+
+TT_JET_OUTPUT(diLepDiJets_DRCut, std::vector<std::vector<uint16_t>>) // di-leptons of combined ID/Iso with di-jets built out of jets having minDRjl>cut taking into account lepton ID/Iso corresponding to the loosest combination of the two leptons of the object
+TT_JET_OUTPUT(diLepDiBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>)
+TT_JET_OUTPUT(diLepDiBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>)
+
+TT_JET_OUTPUT(diLepDiJetsMet, std::vector<TTAnalysis::DiLepDiJetMet>)
+
+TT_JET_OUTPUT(diLepDiJetsMet_DRCut, std::vector<std::vector<uint16_t>>)
+TT_JET_OUTPUT(diLepDiBJetsMet_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>)
+TT_JET_OUTPUT(diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>)
+
+TT_JET_OUTPUT(ttbar, std::vector<std::vector<std::vector<TTAnalysis::TTBar>>>)
+TT_JET_OUTPUT(ttbar_compact, std::vector<std::vector<std::vector<TTAnalysis::TTBarCompact>>>) // Same as `ttbar`, with TTBarCompact objects
+TT_JET_OUTPUT(ttbar_smeared, std::vector<std::vector<TTAnalysis::TTBarSmeared>>) // Indexed as `ttbar`, only filled with `ttbarSmearingSamples`: resolution-smeared reconstruction of each candidate
+TT_JET_OUTPUT(ttbar_rejected, std::vector<std::vector<uint8_t>>) // Indexed as `ttbar`, only filled with `neutrinosSolverPrecheck`: bit 0 (1) set if the b-jet assignment (swapped) of the candidate is above the m_lb endpoint, and was rejected by the solver
+
+// Gen matching. All indexes are from the `genParticles` collection
+TT_OUTPUT(genParticles, std::vector<TTAnalysis::GenParticle>)
+TT_OUTPUT(gen_t, int16_t) // Index of the top quark
+TT_OUTPUT(gen_t_beforeFSR, int16_t) // Index of the top quark, before any FSR
+TT_OUTPUT(gen_tbar, int16_t) // Index of the anti-top quark
+TT_OUTPUT(gen_tbar_beforeFSR, int16_t) // Index of the anti-top quark, before any FSR
+TT_OUTPUT(gen_t_tbar_deltaR, float) // DeltaR between the top and the anti-top quark
+TT_OUTPUT(gen_t_tbar_deltaEta, float) // DeltaEta between the top and the anti-top quark
+TT_OUTPUT(gen_t_tbar_deltaPhi, float) // DeltaPhi between the top and the anti-top quark
+
+TT_OUTPUT(gen_b, int16_t) // Index of the b quark coming from the top decay
+TT_OUTPUT(gen_b_beforeFSR, int16_t) // Index of the b quark coming from the top decay, before any FSR
+TT_OUTPUT(gen_bbar, int16_t) // Index of the anti-b quark coming from the anti-top decay
+TT_OUTPUT(gen_bbar_beforeFSR, int16_t) // Index of the anti-b quark coming from the anti-top decay, before any FSR
+TT_OUTPUT(gen_b_bbar_deltaR, float) // DeltaR between the b and the anti-b quark
+
+TT_OUTPUT(gen_jet1_t, int16_t) // Index of the first jet from the top decay chain
+TT_OUTPUT(gen_jet1_t_beforeFSR, int16_t) // Index of the first jet from the top decay chain, before any FSR
+TT_OUTPUT(gen_jet2_t, int16_t) // Index of the second jet from the top decay chain
+TT_OUTPUT(gen_jet2_t_beforeFSR, int16_t) // Index of the second jet from the top decay chain, before any FSR
+
+TT_OUTPUT(gen_jet1_tbar, int16_t) // Index of the first jet from the anti-top decay chain
+TT_OUTPUT(gen_jet1_tbar_beforeFSR, int16_t) // Index of the first jet from the anti-top decay chain, before any FSR
+TT_OUTPUT(gen_jet2_tbar, int16_t) // Index of the second jet from the anti-top decay chain
+TT_OUTPUT(gen_jet2_tbar_beforeFSR, int16_t) // Index of the second jet from the anti-top decay chain, before any FSR
+
+TT_OUTPUT(gen_lepton_t, int16_t) // Index of the lepton from the top decay chain
+TT_OUTPUT(gen_lepton_t_beforeFSR, int16_t) // Index of the lepton from the top decay chain, before any FSR
+TT_OUTPUT(gen_neutrino_t, int16_t) // Index of the neutrino from the top decay chain
+TT_OUTPUT(gen_neutrino_t_beforeFSR, int16_t) // Index of the neutrino from the top decay chain, before any FSR
+
+TT_OUTPUT(gen_lepton_tbar, int16_t) // Index of the lepton from the anti-top decay chain
+TT_OUTPUT(gen_lepton_tbar_beforeFSR, int16_t) // Index of the lepton from the anti-top decay chain, before any FSR
+TT_OUTPUT(gen_neutrino_tbar, int16_t) // Index of the neutrino from the anti-top decay chain
+TT_OUTPUT(gen_neutrino_tbar_beforeFSR, int16_t) // Index of the neutrino from the anti-top decay chain, before any FSR
+
+TT_OUTPUT(gen_ttbar_decay_type, char) // Type of ttbar decay. Can take any values from TTDecayType enum
+
+TT_OUTPUT(gen_ttbar_beforeFSR_p4, myLorentzVector)
+TT_OUTPUT(gen_ttbar_p4, myLorentzVector)
+
+// Matching for the dileptonic case
+
+TT_OUTPUT(gen_b_lepton_t_deltaR, float) // DeltaR between the b quark and the lepton coming from the top decay chain
+TT_OUTPUT(gen_bbar_lepton_tbar_deltaR, float) // DeltaR between the b quark and the lepton coming from the top decay chain
+
+// These two vectors are indexed wrt LepLepId enum
+TT_JET_OUTPUT(gen_b_deltaR, std::vector<std::vector<float>>) // DeltaR between the gen b coming from the top decay and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
+TT_JET_OUTPUT(gen_bbar_deltaR, std::vector<std::vector<float>>) // DeltaR between the gen bbar coming from the anti-top decay chain and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
+
+// These two vectors are indexed wrt LepLepId enum
+TT_JET_OUTPUT(gen_b_beforeFSR_deltaR, std::vector<std::vector<float>>) // DeltaR between the gen b coming from the top decay and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
+TT_JET_OUTPUT(gen_bbar_beforeFSR_deltaR, std::vector<std::vector<float>>) // DeltaR between the gen bbar coming from the anti-top decay chain and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
+
+TT_OUTPUT(gen_lepton_t_deltaR, std::vector<float>) // DeltaR between the gen lepton coming from the top decay chain and each selected lepton. Indexed as `leptons` array
+TT_OUTPUT(gen_lepton_tbar_deltaR, std::vector<float>) // DeltaR between the gen lepton coming from the anti-top decay chain and each selected lepton. Indexed as `leptons` array
+
+// These two vectors are indexed wrt LepLepId enum
+TT_JET_OUTPUT(gen_matched_b, std::vector<int8_t>) // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen b coming from the top decay
+TT_JET_OUTPUT(gen_matched_bbar, std::vector<int8_t>) // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen bbar coming from the anti-top decay
+
+// These two vectors are indexed wrt LepLepId enum
+TT_JET_OUTPUT(gen_matched_b_beforeFSR, std::vector<int8_t>) // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen b coming from the top decay
+TT_JET_OUTPUT(gen_matched_bbar_beforeFSR, std::vector<int8_t>) // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen bbar coming from the anti-top decay
+
+TT_OUTPUT(gen_matched_lepton_t, int16_t) // Index inside the `leptons` collection of the lepton with the smallest deltaR with the gen lepton coming from the top decay chain
+TT_OUTPUT(gen_matched_lepton_tbar, int16_t) // Index inside the `leptons` collection of the lepton with the smallest deltaR with the gen lepton coming from the anti-top decay chain
+
+#ifdef TT_JET_OUTPUT_IS_TT_OUTPUT
+#undef TT_JET_OUTPUT
+#undef TT_JET_OUTPUT_IS_TT_OUTPUT
+#endif
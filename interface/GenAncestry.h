@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <cp3_llbb/TTAnalysis/interface/Column.h>
+
+namespace TTAnalysis {
+
+  // Ancestry of the pruned gen particles, following the first mother of each particle
+  // (as done when walking the decay chains by hand).
+  // The table is built once per event in linear time; `decaysFrom` is then a constant-time lookup.
+  class GenAncestry {
+    public:
+
+      void build(const Column<std::vector<uint16_t>>& mothers_index);
+
+      // True if `mother_index` is found in the first-mother chain of `particle_index`
+      bool decaysFrom(size_t particle_index, size_t mother_index) const {
+        if (particle_index >= m_entry.size() || mother_index >= m_entry.size())
+          return false;
+
+        // Particles not reachable from a root (broken mother chain) have no ancestry
+        if (m_entry[particle_index] < 0 || m_entry[mother_index] < 0)
+          return false;
+
+        return m_entry[mother_index] < m_entry[particle_index] && m_entry[particle_index] <= m_exit[mother_index];
+      }
+
+    private:
+
+      // Pre-order position of each particle in a depth-first walk of the first-mother forest,
+      // and largest position found in its sub-tree: the descendants of a particle are exactly
+      // the particles with an entry in ]m_entry, m_exit].
+      std::vector<int32_t> m_entry;
+      std::vector<int32_t> m_exit;
+
+      // Work arrays, kept to avoid re-allocating them for each event
+      std::vector<int32_t> m_parent;
+      std::vector<uint32_t> m_first_child;
+      std::vector<uint32_t> m_children;
+      std::vector<std::pair<uint32_t, uint32_t>> m_stack;
+  };
+
+}
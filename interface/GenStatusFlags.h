@@ -3,6 +3,7 @@
 // Code from https://raw.githubusercontent.com/cms-sw/cmssw/CMSSW_7_4_X/DataFormats/HepMCCandidate/interface/GenStatusFlags.h
 
 #include <bitset>
+#include <iostream>
 
 struct GenStatusFlags {
 
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/Indices.h>
+#include <cp3_llbb/TTAnalysis/interface/EventOutputs.h>
+
+namespace TTAnalysis {
+
+  // Fixed-width binning, with an underflow (index 0) and an overflow (index `bins() + 1`) bin
+  class Histogram {
+    public:
+      Histogram(uint32_t bins, double min, double max);
+
+      void fill(double value, double weight = 1);
+
+      // Add the content of a histogram with the same binning (e.g. filled by another analyzer instance)
+      void merge(const Histogram& other);
+
+      uint32_t bins() const {
+        return m_sumw.size() - 2;
+      }
+      double min() const {
+        return m_min;
+      }
+      double max() const {
+        return m_max;
+      }
+
+      uint64_t entries() const {
+        return m_entries;
+      }
+      double sumw(uint32_t bin) const {
+        return m_sumw[bin];
+      }
+      double sumw2(uint32_t bin) const {
+        return m_sumw2[bin];
+      }
+
+    private:
+      double m_min, m_max;
+      uint64_t m_entries = 0;
+      std::vector<double> m_sumw, m_sumw2;
+  };
+
+  // Variables which can be histogrammed, and the combinations they are indexed with
+  namespace HistogramVariable {
+    enum Variable{
+      Mll,    // Leading DiLepton (LepLepIDIso combinations, ex.: "IDTT_IsoTT")
+      NBJets, // Number of selected b-jets (LepIDIsoJetBWP combinations, ex.: "IDT_IsoT_BM")
+      Mjj,    // Leading di-b-jet, CSVv2-ordered (LepIDIsoJetJetBWP combinations, ex.: "IDT_IsoT_BMM")
+      Mlljj,  // Leading di-lepton-di-b-jet, CSVv2-ordered (LepLepIDIsoJetJetBWP combinations, ex.: "Lep_IDTT_IsoTT_BMM")
+      Mtt,    // Minimum mtt solution of the leading ttbar candidate (LepLepIDIsoJetJetBWP combinations)
+      Count
+    };
+    const std::array<Variable, Count> it = {{ Mll, NBJets, Mjj, Mlljj, Mtt }};
+    const std::map<Variable, std::string> map = { {Mll, "mll"}, {NBJets, "nBJets"}, {Mjj, "mjj"}, {Mlljj, "mlljj"}, {Mtt, "mtt"} };
+  }
+
+  struct HistogramConfig {
+    std::string name;
+    HistogramVariable::Variable variable;
+    uint32_t bins;
+    double min, max;
+    std::vector<std::string> combinations; // Named as the combinations of the variable (see HistogramVariable)
+  };
+
+  /*
+   * Histograms filled directly from the outputs of the analysis, instead of storing the per-event trees.
+   * For each configuration, one histogram is filled per combination and per flavour of the leading DiLepton
+   * of the corresponding lepton ID/Iso, named `<name>_<combination>_<flavour>`. Events without such a DiLepton are not counted.
+   * Each instance holds its own buffers: instances processing events in parallel are merged at the end of the job (see HistogramsFile).
+   */
+  class HistogramAggregator {
+    public:
+      // Throws std::invalid_argument for unknown combinations or invalid binnings
+      explicit HistogramAggregator(const std::vector<HistogramConfig>& configs);
+
+      // Outputs (as named in EventOutputsList.h) read to fill the histograms, which must be computed even if their branches are disabled
+      static std::set<std::string> requiredOutputs(const std::vector<HistogramConfig>& configs);
+
+      void fill(const EventOutputs& outputs, double weight = 1);
+
+      void merge(const HistogramAggregator& other);
+
+      // Write all the histograms as TH1F in a new ROOT file
+      void write(const std::string& path) const;
+
+      const std::vector<std::string>& names() const {
+        return m_names;
+      }
+      const std::vector<Histogram>& histograms() const {
+        return m_histograms;
+      }
+
+    private:
+      struct Entry {
+        HistogramVariable::Variable variable;
+        uint16_t combination; // Index of the combination in the outputs
+        uint16_t diLepton; // Lepton ID/Iso combination defining the flavour category, indexed as `diLeptons_summary`
+        size_t first_histogram; // Followed by the other flavours, in the DiLepFlavour order
+      };
+
+      std::vector<Entry> m_entries;
+      std::vector<std::string> m_names;
+      std::vector<Histogram> m_histograms;
+  };
+
+  /*
+   * ROOT file shared by the aggregators writing to the same path, e.g. those of the analyzer instances of the different streams.
+   * Their histograms are merged, and the file is written once, when the last of them has been added.
+   */
+  class HistogramsFile {
+    public:
+      explicit HistogramsFile(const std::string& path): m_path(path) {}
+
+      // Registers one more aggregator writing to `path`: each caller must add its histograms exactly once
+      static std::shared_ptr<HistogramsFile> open(const std::string& path);
+
+      // Merge the histograms of one of the callers of open(). Returns true if they were the last ones and the file has been written.
+      // Throws std::invalid_argument if they are configured differently from the previous ones.
+      bool add(const HistogramAggregator& histograms);
+
+    private:
+      std::mutex m_mutex;
+      const std::string m_path;
+      size_t m_pending = 0; // Callers of open() which have not added their histograms yet
+      std::unique_ptr<HistogramAggregator> m_merged;
+  };
+
+}
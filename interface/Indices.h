@@ -81,6 +81,28 @@ namespace TTAnalysis {
   std::string LepLepIDIsoJetJetBWPStr(const LepID::LepID& id1, const LepIso::LepIso& iso1, const LepID::LepID& id2, const LepIso::LepIso& iso2, const BWP::BWP& wp1, const BWP::BWP& wp2);
 
 
+  // Flavour of a DiLepton object (leading lepton first)
+  namespace DiLepFlavour {
+    enum DiLepFlavour{ ElEl, ElMu, MuEl, MuMu, Count };
+    const std::array<DiLepFlavour, Count> it = {{ ElEl, ElMu, MuEl, MuMu }};
+    const std::map<DiLepFlavour, std::string> map = { {ElEl, "ElEl"}, {ElMu, "ElMu"}, {MuEl, "MuEl"}, {MuMu, "MuMu"} };
+  }
+
+  // Analyzer preselection: stage at which an event has been rejected (or Passed)
+  namespace Preselection {
+    enum Stage{ Passed, Leptons, Jets, Count };
+    const std::array<Stage, Count> it = {{ Passed, Leptons, Jets }};
+    const std::map<Stage, std::string> map = { {Passed, "Passed"}, {Leptons, "Leptons"}, {Jets, "Jets"} };
+  }
+
+  // Stages skipped for events exceeding the configured collection sizes (bits of the `degraded` output)
+  namespace Degradation {
+    enum Stage{ DiLepDiJets, TTBar, Count };
+    const std::array<Stage, Count> it = {{ DiLepDiJets, TTBar }};
+    const std::map<Stage, std::string> map = { {DiLepDiJets, "DiLepDiJets"}, {TTBar, "TTBar"} };
+  }
+
+
   enum TTDecayType {
     UnknownTT = -1,
     NotTT = 0,
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
 #include <vector>
 #include <utility>
 
@@ -24,18 +26,141 @@ class NeutrinosSolver {
     public:
         using LorentzVector = ROOT::Math::LorentzVector<ROOT::Math::PxPyPzE4D<double>>;
 
-        NeutrinosSolver(float top_mass, float w_mass):
-            t_mass(top_mass), w_mass(w_mass) {
+        // Outcome of `getNeutrinos`
+        enum Status {
+            Solved, // At least one solution with positive neutrino energies
+            InvalidInput, // Non-finite input momenta
+            BJetPzZero, // One b-jet has (almost) no longitudinal momentum: the system cannot be linearized
+            Degenerate, // Lepton and b-jet transverse directions make the linear system singular (Dx = -Dy ~ 0)
+            AboveMlbEndpoint, // A lepton-b-jet pair is above the m_lb endpoint of the mass hypothesis, only checked with `precheck` (see the constructor)
+            NoRealSolution, // The two conics do not intersect
+            NoPositiveSolution, // All the intersections have a negative neutrino energy
+            Count
+        };
+
+        struct MassHypothesis {
+            float top_mass;
+            float w_mass;
+        };
+
+        // Objects of one configuration to solve
+        struct Configuration {
+            LorentzVector lepton1_p4, lepton2_p4;
+            LorentzVector bjet1_p4, bjet2_p4;
+            LorentzVector met;
+        };
+
+        // Solutions for several mass hypotheses, or several configurations, stored contiguously
+        class SolutionTable {
+            public:
+                // Number of mass hypotheses, or configurations
+                size_t size() const {
+                    return m_status.size();
+                }
+
+                Status status(size_t hypothesis) const {
+                    return m_status[hypothesis];
+                }
+
+                // Number of solutions for a mass hypothesis, or configuration
+                size_t solutions(size_t hypothesis) const {
+                    return m_offsets[hypothesis + 1] - m_offsets[hypothesis];
+                }
+
+                const std::pair<LorentzVector, LorentzVector>& solution(size_t hypothesis, size_t index) const {
+                    return m_neutrinos[m_offsets[hypothesis] + index];
+                }
+
+            private:
+                friend class NeutrinosSolver;
+
+                std::vector<std::pair<LorentzVector, LorentzVector>> m_neutrinos;
+                std::vector<uint32_t> m_offsets; // Solutions of hypothesis `h` are m_neutrinos[m_offsets[h]] to m_neutrinos[m_offsets[h + 1]] (excluded)
+                std::vector<Status> m_status;
+        };
+
+        // With `precheck`, the configurations above the m_lb endpoint are rejected before building the conics (the solutions are the same).
+        // With a massless neutrino and on-shell W and top: m_lb^2 - m_l^2 = mt^2 - mW^2 - 2 p_nu.p_b <= mt^2 - mW^2 (endpoint of m_lb).
+        // The bound only holds for a time-like b-jet: a b-jet with a negative squared mass is never rejected.
+        NeutrinosSolver(float top_mass, float w_mass, bool precheck = true):
+            t_mass(top_mass), w_mass(w_mass), m_precheck(precheck) {
             // Empty
         }
 
-        std::vector<std::pair<LorentzVector, LorentzVector>> getNeutrinos(const LorentzVector& lepton1_p4, 
-                const LorentzVector& lepton2_p4, 
-                const LorentzVector& bjet1_p4, 
+        std::vector<std::pair<LorentzVector, LorentzVector>> getNeutrinos(const LorentzVector& lepton1_p4,
+                const LorentzVector& lepton2_p4,
+                const LorentzVector& bjet1_p4,
+                const LorentzVector& bjet2_p4,
+                const LorentzVector& met) const;
+
+        // Same as above, but also returns why no solution has been found, if any.
+        // Degenerate and kinematically forbidden configurations are rejected before running the quartic solver.
+        std::vector<std::pair<LorentzVector, LorentzVector>> getNeutrinos(const LorentzVector& lepton1_p4,
+                const LorentzVector& lepton2_p4,
+                const LorentzVector& bjet1_p4,
+                const LorentzVector& bjet2_p4,
+                const LorentzVector& met,
+                Status& status) const;
+
+        // Solve the same configuration for several (top, W) mass hypotheses. The mass-independent part
+        // of the system is only computed once. `table` is overwritten, and can be reused across calls.
+        void getNeutrinos(const LorentzVector& lepton1_p4,
+                const LorentzVector& lepton2_p4,
+                const LorentzVector& bjet1_p4,
                 const LorentzVector& bjet2_p4,
-                const LorentzVector& met);
+                const LorentzVector& met,
+                const std::vector<MassHypothesis>& hypotheses,
+                SolutionTable& table) const;
+
+        // Solve a batch of configurations with the nominal masses, e.g. resolution-smeared copies of the same objects. The setup of the
+        // system and the coefficients of the quartic are computed for blocks of configurations at once, in structure-of-arrays form.
+        // `table` is indexed by configuration: it is overwritten, and can be reused across calls.
+        void getNeutrinos(const std::vector<Configuration>& batch, SolutionTable& table) const;
 
     private:
+        // Mass-independent part of the system
+        struct Kinematics;
+
+        // InvalidInput, BJetPzZero, or Solved if the configuration can be solved
+        Status inputStatus(const LorentzVector& lepton1_p4,
+                const LorentzVector& lepton2_p4,
+                const LorentzVector& bjet1_p4,
+                const LorentzVector& bjet2_p4,
+                const LorentzVector& met) const;
+
+        void solveHypotheses(const LorentzVector& lepton1_p4,
+                const LorentzVector& lepton2_p4,
+                const LorentzVector& bjet1_p4,
+                const LorentzVector& bjet2_p4,
+                const LorentzVector& met,
+                const MassHypothesis* hypotheses,
+                size_t n_hypotheses,
+                std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos,
+                uint32_t* offsets,
+                Status* status) const;
+
+        void solveAll(const Kinematics& kinematics, const MassHypothesis* hypotheses, size_t n_hypotheses,
+                std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos, uint32_t* offsets, Status* status) const;
+
+        Status solve(const Kinematics& kinematics,
+                const MassHypothesis& hypothesis,
+                std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos) const;
+
+        // Pre-check of a configuration (see the constructor), from the scalar products of its leptons and b-jets
+        bool aboveMlbEndpoint(const double p34, const double p44, const double p56, const double p66, const MassHypothesis& hypothesis) const;
+
+        // Configurations of the batch call solved together
+        static constexpr size_t m_block_size = 16;
+        struct Block;
+
+        void solveBatch(const std::vector<Configuration>& batch, SolutionTable& table) const;
+
+        void solveBlock(const Block& b, const MassHypothesis& hypothesis, SolutionTable& table) const;
+
+        // Relative tolerance of the degeneracy checks
+        static constexpr double m_epsilon = 1e-9;
+
         float t_mass = 172.5;
         float w_mass = 80.4;
+        bool m_precheck = true;
 };
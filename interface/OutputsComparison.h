@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/EventOutputs.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Field-by-field comparison of the outputs of a reference and a candidate analysis on the same events.
+   * Integers, flags and index lists must be identical. Floating-point values and four-vectors (Pt, Eta, Phi, E)
+   * are compared within a relative tolerance. The ttbar solutions of each candidate are compared up to their ordering.
+   * Transient members (pointers) are not compared.
+   */
+  class OutputsComparison {
+    public:
+      // Keep the first `examples` differences of each output for the report
+      explicit OutputsComparison(double tolerance = 1e-5, size_t examples = 5);
+
+      // Returns the number of differing fields in this event
+      uint64_t compare(uint32_t run, uint32_t lumi, uint64_t event, const EventOutputs& reference, const EventOutputs& candidate);
+
+      // Outputs with differences: number of events and fields differing, and the first differences
+      void report(std::ostream& out) const;
+
+      bool identical() const {
+        return m_differing_events == 0;
+      }
+
+    private:
+      const double m_tolerance;
+      const size_t m_max_examples;
+
+      uint64_t m_events = 0, m_differing_events = 0;
+
+      // Indexed as the outputs in EventOutputsList.h
+      std::vector<std::string> m_names;
+      std::vector<uint64_t> m_output_events, m_output_differences;
+      std::vector<std::vector<std::string>> m_examples;
+  };
+
+}
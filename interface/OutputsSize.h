@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/EventOutputs.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Size of the outputs of each event, per collection (see EventOutputsList.h): number of objects
+   * (innermost elements of the nested arrays) and approximate bytes held (the array headers and their capacity,
+   * as the arrays are reused across events). Keeps the high-water mark of each collection and the largest events.
+   */
+  class OutputsSizeMonitor {
+    public:
+      // Keep the `worstEvents` largest events
+      explicit OutputsSizeMonitor(size_t worstEvents);
+
+      void measure(uint32_t run, uint32_t lumi, uint64_t event, const EventOutputs& outputs);
+
+      // Print the collections with the largest high-water marks, and the largest events
+      void report(std::ostream& out, size_t collections = 10) const;
+
+      struct Event {
+        uint32_t run, lumi;
+        uint64_t event;
+        uint64_t bytes;
+        size_t largest_collection;
+        uint64_t largest_collection_bytes;
+      };
+
+    private:
+      const size_t m_worstEvents;
+
+      std::vector<std::string> m_names;
+      std::vector<uint64_t> m_objects, m_bytes; // Current event, indexed as `m_names`
+      std::vector<uint64_t> m_max_objects, m_max_bytes; // High-water marks
+
+      uint64_t m_events = 0, m_total_bytes = 0;
+      std::vector<Event> m_worst; // Min-heap on the bytes
+  };
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+
+namespace TTAnalysis {
+
+  /*
+   * Small random number generator (SplitMix64) whose sequence only depends on its seed. Seeded from the event and candidate numbers,
+   * the numbers drawn for a candidate don't depend on the processing order, the threads or the other candidates.
+   * The uniform and Gaussian transforms are implemented here, as the std distributions differ between standard libraries.
+   */
+  class RandomStream {
+    public:
+      explicit RandomStream(uint64_t seed): m_state(seed) {}
+
+      // Combine several numbers (e.g. run, event and candidate numbers) into a seed
+      static uint64_t seed(std::initializer_list<uint64_t> values) {
+        uint64_t seed = 0;
+        for (const uint64_t& value: values)
+          seed = mix(seed ^ (value + 0x9e3779b97f4a7c15ULL));
+        return seed;
+      }
+
+      uint64_t next() {
+        m_state += 0x9e3779b97f4a7c15ULL;
+        return mix(m_state);
+      }
+
+      // In (0, 1]
+      double uniform() {
+        return ((next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+      }
+
+      // Normal distribution (Box-Muller), the numbers being drawn by pairs
+      double gaussian() {
+        if (m_has_gaussian) {
+          m_has_gaussian = false;
+          return m_gaussian;
+        }
+
+        const double radius = std::sqrt(-2 * std::log(uniform()));
+        const double angle = 2 * M_PI * uniform();
+        m_gaussian = radius * std::sin(angle);
+        m_has_gaussian = true;
+        return radius * std::cos(angle);
+      }
+
+    private:
+      uint64_t m_state;
+      double m_gaussian = 0;
+      bool m_has_gaussian = false;
+
+      static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+      }
+  };
+
+}
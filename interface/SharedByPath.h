@@ -0,0 +1,30 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace TTAnalysis {
+
+  /*
+   * Instance of T for `path`, shared by all the callers asking for the same path, e.g. the analyzer instances of the different streams.
+   * The first caller builds it as T(path), and it is destroyed when the last caller releases it: a later caller then gets a new one.
+   * Can be called concurrently.
+   */
+  template<typename T>
+  std::shared_ptr<T> sharedByPath(const std::string& path) {
+
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<T>> instances;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<T> instance = instances[path].lock();
+    if (!instance) {
+      instance = std::make_shared<T>(path);
+      instances[path] = instance;
+    }
+    return instance;
+  }
+
+}
@@ -1,221 +1,195 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <set>
+#include <stdexcept>
 #include <string>
-#include <utility>
 #include <vector>
-#include <limits>
 
-#include <cp3_llbb/Framework/interface/MuonsProducer.h>
-#include <cp3_llbb/Framework/interface/JetsProducer.h>
 #include <cp3_llbb/Framework/interface/Analyzer.h>
 
 #include <cp3_llbb/TTAnalysis/interface/Types.h>
-#include <cp3_llbb/TTAnalysis/interface/Tools.h>
-
+#include <cp3_llbb/TTAnalysis/interface/AnalysisCore.h>
+#include <cp3_llbb/TTAnalysis/interface/EventCapture.h>
+#include <cp3_llbb/TTAnalysis/interface/Histograms.h>
+#include <cp3_llbb/TTAnalysis/interface/OutputsSize.h>
+
+// Same as BRANCH, but the branch is only written to the tree if it has not been disabled through the `disabledBranches` parameter.
+// A disabled branch is kept in memory as a transient branch, but is left empty if nothing else needs it.
+#define OPTIONAL_BRANCH(NAME, ...) __VA_ARGS__& NAME = registerBranch(#NAME) ? tree[#NAME].write<__VA_ARGS__>() : tree[#NAME].transient_write<__VA_ARGS__>()
+
+/*
+ * Adapter between the framework and TTAnalysis::AnalysisCore: reads the producers into plain arrays,
+ * runs the analysis, and moves its outputs to the branches.
+ */
 class TTAnalyzer: public Framework::Analyzer {
+    private:
+        // Needed before the branches are declared
+        const std::set<std::string> m_disabledBranches;
+        std::set<std::string> m_declaredBranches;
+
+        bool registerBranch(const std::string& name) {
+            m_declaredBranches.insert(name);
+            return isBranchEnabled(name);
+        }
+
+        TTAnalysis::AnalysisCore m_core;
+
     public:
         TTAnalyzer(const std::string& name, const ROOT::TreeGroup& tree_, const edm::ParameterSet& config):
             Analyzer(name, tree_, config),
 
+            // List of branches, or groups of branches (see `branchGroups`), not to be written to the tree.
+            // Computations only feeding disabled branches are skipped.
+            // Only one of `ttbar` and `ttbar_compact` is written, depending on `compactTTBar`. `ttbar_rejected` is only written
+            // with `neutrinosSolverPrecheck`, and `ttbar_smeared` with `ttbarSmearingSamples`.
+            m_disabledBranches( disabledBranches(config) ),
+
+            m_core( analysisConfig(config, m_disabledBranches) ),
+
             // Not untracked as these parameters are mandatory
             m_electrons_producer(config.getParameter<std::string>("electronsProducer")),
             m_muons_producer(config.getParameter<std::string>("muonsProducer")),
             m_jets_producer(config.getParameter<std::string>("jetsProducer")),
             m_met_producer(config.getParameter<std::string>("metProducer")),
-            
-            m_electronPtCut( config.getUntrackedParameter<double>("electronPtCut", 20) ),
-            m_electronEtaCut( config.getUntrackedParameter<double>("electronEtaCut", 2.5) ),
+
+            // Resolved when reading the producers
             m_electronVetoIDName( config.getUntrackedParameter<std::string>("electronVetoIDName") ),
             m_electronLooseIDName( config.getUntrackedParameter<std::string>("electronLooseIDName") ),
             m_electronMediumIDName( config.getUntrackedParameter<std::string>("electronMediumIDName") ),
             m_electronTightIDName( config.getUntrackedParameter<std::string>("electronTightIDName") ),
-            
-            m_muonPtCut( config.getUntrackedParameter<double>("muonPtCut", 20) ),
-            m_muonEtaCut( config.getUntrackedParameter<double>("muonEtaCut", 2.4) ),
-            m_muonLooseIsoCut( config.getUntrackedParameter<double>("muonLooseIsoCut", 0.2) ),
-            m_muonTightIsoCut( config.getUntrackedParameter<double>("muonTightIsoCut", 0.12) ),
-            
-            m_jetPtCut( config.getUntrackedParameter<double>("jetPtCut", 30) ),
-            m_jetEtaCut( config.getUntrackedParameter<double>("jetEtaCut", 2.5) ),
-            m_bJetEtaCut( config.getUntrackedParameter<double>("bJetEtaCut", 2.4) ),
-            m_jetPUID( config.getUntrackedParameter<double>("jetPUID", std::numeric_limits<float>::min()) ),
-            m_jetDRleptonCut( config.getUntrackedParameter<double>("jetDRleptonCut", 0.3) ),
-            m_jetID( config.getUntrackedParameter<std::string>("jetID", "loose") ),
             m_jetCSVv2Name( config.getUntrackedParameter<std::string>("jetCSVv2Name", "pfCombinedInclusiveSecondaryVertexV2BJetTags") ),
-            m_jetCSVv2L( config.getUntrackedParameter<double>("jetCSVv2L", 0.605) ),
-            m_jetCSVv2M( config.getUntrackedParameter<double>("jetCSVv2M", 0.89) ),
-            m_jetCSVv2T( config.getUntrackedParameter<double>("jetCSVv2T", 0.97) ),
-            
-            m_hltDRCut( config.getUntrackedParameter<double>("hltDRCut", std::numeric_limits<float>::max()) ),
-            m_hltDPtCut( config.getUntrackedParameter<double>("hltDPtCut", std::numeric_limits<float>::max()) )
+
+            // ROOT file in which the `histograms` are written at the end of the job
+            m_histogramsFile( config.getUntrackedParameter<std::string>("histogramsFile", "") ),
+
+            // Fill the histograms of simulated events with their generator weight (negative for part of the events of NLO samples),
+            // read from the `eventProducer`. Real data events always have a weight of 1.
+            m_histogramsWeighted( config.getUntrackedParameter<bool>("histogramsWeighted", true) ),
+            m_event_producer( config.getUntrackedParameter<std::string>("eventProducer", "event") )
         {
+            for(const std::string& branch: m_disabledBranches){
+                if(!m_declaredBranches.count(branch))
+                    throw edm::Exception(edm::errors::Configuration, "Unknown branch '" + branch + "' passed to disabledBranches");
+            }
+
+            // Jet systematic variations processed by this analyzer, see `JetSystematic`
+            for(const edm::ParameterSet& systematic: config.getUntrackedParameter<std::vector<edm::ParameterSet>>("jetSystematics", std::vector<edm::ParameterSet>()))
+                m_jetSystematics.emplace_back(systematic, m_met_producer, tree, m_disabledBranches);
+
+            // If set, the inputs of each event are also written to this file (see EventCapture.h), to be replayed without the framework.
+            // The instances of the different streams share the file.
+            const std::string captureFile = config.getUntrackedParameter<std::string>("captureFile", "");
+            if(!captureFile.empty())
+                m_capture = TTAnalysis::EventCaptureWriter::shared(captureFile);
+
+            // Histograms filled directly by the analyzer, see `histogramConfigs` and TTAnalysis::HistogramAggregator
+            const std::vector<TTAnalysis::HistogramConfig> histograms = histogramConfigs(config);
+            if(!histograms.empty()){
+                if(m_histogramsFile.empty())
+                    throw edm::Exception(edm::errors::Configuration, "histogramsFile must be set to fill histograms");
+                try {
+                    m_histograms.reset(new TTAnalysis::HistogramAggregator(histograms));
+                } catch(const std::invalid_argument& e) {
+                    throw edm::Exception(edm::errors::Configuration, e.what());
+                }
+                // The instances of the different streams share the file, and merge their histograms into it
+                m_histogramsOutput = TTAnalysis::HistogramsFile::open(m_histogramsFile);
+            }
+
+            // Number of largest events (by size of their outputs) reported at the end of the job (0: the sizes are not measured).
+            // Measuring walks all the outputs of each event: meant for the jobs investigating the memory use.
+            const size_t sizeReportEvents = config.getUntrackedParameter<unsigned int>("sizeReportEvents", 0);
+            if(sizeReportEvents)
+                m_outputsSize.reset(new TTAnalysis::OutputsSizeMonitor(sizeReportEvents));
         }
 
         virtual void analyze(const edm::Event&, const edm::EventSetup&, const ProducersManager&, const AnalyzersManager&, const CategoryManager&) override;
         virtual void registerCategories(CategoryManager& manager, const edm::ParameterSet&) override;
+        virtual void endJob(MetadataManager&) override;
 
-        BRANCH(electrons_IDIso, std::vector<std::vector<uint16_t>>);
-        BRANCH(muons_IDIso, std::vector<std::vector<uint16_t>>);
-
-        BRANCH(leptons, std::vector<TTAnalysis::Lepton>);
-        BRANCH(leptons_IDIso, std::vector<std::vector<uint16_t>>);
-
-        BRANCH(diLeptons, std::vector<TTAnalysis::DiLepton>);
-        BRANCH(diLeptons_IDIso, std::vector<std::vector<uint16_t>>);
-
-        BRANCH(selJets, std::vector<TTAnalysis::Jet>);
-        BRANCH(selJets_selID, std::vector<uint16_t>);
-        // ex.: selectedJets_..._DRCut[X][0] is the highest Pt selected jet with minDRjl>0.3 taking into account ID/Iso-X Leptons
-        BRANCH(selJets_selID_DRCut, std::vector<std::vector<uint16_t>>);
-        // ex.: selectedBJets_..._PtOrdered[X][0] is the highest Pt selected jet with minDRjl>0.3 taking into account ID/Iso/Btag-X combination
-        BRANCH(selBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>);
-        BRANCH(selBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>);
-
-        BRANCH(diJets, std::vector<TTAnalysis::DiJet>);
-        // ex.: diJets_DRCut[X][0] is first diJet with minDRjl>0.3 taking into account ID/Iso-X Leptons
-        BRANCH(diJets_DRCut, std::vector<std::vector<uint16_t>>); 
-        // ex.: diBJets_..._CSVv2Ordered[X][0] is the b-jet pair with highest CSVv2 values and with minDRjl>0.3 taking into account the leptonID/Iso/Btag-X combination
-        BRANCH(diBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>);
-        BRANCH(diBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>);
-
-        // For all the following: indices are combinations of LeptonID/LeptonIso/(B-tagging working point)
-
-        BRANCH(diLepDiJets, std::vector<TTAnalysis::DiLepDiJet>);
-        
-        BRANCH(diLepDiJets_DRCut, std::vector<std::vector<uint16_t>>); // di-leptons of combined ID/Iso with di-jets built out of jets having minDRjl>cut taking into account lepton ID/Iso corresponding to the loosest combination of the two leptons of the object
-        BRANCH(diLepDiBJets_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>);
-        BRANCH(diLepDiBJets_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>);
-
-        BRANCH(diLepDiJetsMet, std::vector<TTAnalysis::DiLepDiJetMet>);
-        
-        BRANCH(diLepDiJetsMet_DRCut, std::vector<std::vector<uint16_t>>); 
-        BRANCH(diLepDiBJetsMet_DRCut_BWP_PtOrdered, std::vector<std::vector<uint16_t>>);
-        BRANCH(diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered, std::vector<std::vector<uint16_t>>);
-        
-        BRANCH(ttbar, std::vector<std::vector<std::vector<TTAnalysis::TTBar>>>);
-
-        // Gen matching. All indexes are from the `genParticles` collection
-        BRANCH(genParticles, std::vector<TTAnalysis::GenParticle>);
-        BRANCH(gen_t, int16_t); // Index of the top quark
-        BRANCH(gen_t_beforeFSR, int16_t); // Index of the top quark, before any FSR
-        BRANCH(gen_tbar, int16_t); // Index of the anti-top quark
-        BRANCH(gen_tbar_beforeFSR, int16_t); // Index of the anti-top quark, before any FSR
-        BRANCH(gen_t_tbar_deltaR, float); // DeltaR between the top and the anti-top quark
-        BRANCH(gen_t_tbar_deltaEta, float); // DeltaEta between the top and the anti-top quark
-        BRANCH(gen_t_tbar_deltaPhi, float); // DeltaPhi between the top and the anti-top quark
-
-        BRANCH(gen_b, int16_t); // Index of the b quark coming from the top decay
-        BRANCH(gen_b_beforeFSR, int16_t); // Index of the b quark coming from the top decay, before any FSR
-        BRANCH(gen_bbar, int16_t); // Index of the anti-b quark coming from the anti-top decay
-        BRANCH(gen_bbar_beforeFSR, int16_t); // Index of the anti-b quark coming from the anti-top decay, before any FSR
-        BRANCH(gen_b_bbar_deltaR, float); // DeltaR between the b and the anti-b quark
-
-        BRANCH(gen_jet1_t, int16_t); // Index of the first jet from the top decay chain
-        BRANCH(gen_jet1_t_beforeFSR, int16_t); // Index of the first jet from the top decay chain, before any FSR
-        BRANCH(gen_jet2_t, int16_t); // Index of the second jet from the top decay chain
-        BRANCH(gen_jet2_t_beforeFSR, int16_t); // Index of the second jet from the top decay chain, before any FSR
-
-        BRANCH(gen_jet1_tbar, int16_t); // Index of the first jet from the anti-top decay chain
-        BRANCH(gen_jet1_tbar_beforeFSR, int16_t); // Index of the first jet from the anti-top decay chain, before any FSR
-        BRANCH(gen_jet2_tbar, int16_t); // Index of the second jet from the anti-top decay chain
-        BRANCH(gen_jet2_tbar_beforeFSR, int16_t); // Index of the second jet from the anti-top decay chain, before any FSR
-
-        BRANCH(gen_lepton_t, int16_t); // Index of the lepton from the top decay chain
-        BRANCH(gen_lepton_t_beforeFSR, int16_t); // Index of the lepton from the top decay chain, before any FSR
-        BRANCH(gen_neutrino_t, int16_t); // Index of the neutrino from the top decay chain
-        BRANCH(gen_neutrino_t_beforeFSR, int16_t); // Index of the neutrino from the top decay chain, before any FSR
-
-        BRANCH(gen_lepton_tbar, int16_t); // Index of the lepton from the anti-top decay chain
-        BRANCH(gen_lepton_tbar_beforeFSR, int16_t); // Index of the lepton from the anti-top decay chain, before any FSR
-        BRANCH(gen_neutrino_tbar, int16_t); // Index of the neutrino from the anti-top decay chain
-        BRANCH(gen_neutrino_tbar_beforeFSR, int16_t); // Index of the neutrino from the anti-top decay chain, before any FSR
-
-        BRANCH(gen_ttbar_decay_type, char); // Type of ttbar decay. Can take any values from TTDecayType enum
-
-        BRANCH(gen_ttbar_beforeFSR_p4, LorentzVector);
-        BRANCH(gen_ttbar_p4, LorentzVector);
-
-        // Matching for the dileptonic case
-
-        BRANCH(gen_b_lepton_t_deltaR, float); // DeltaR between the b quark and the lepton coming from the top decay chain
-        BRANCH(gen_bbar_lepton_tbar_deltaR, float); // DeltaR between the b quark and the lepton coming from the top decay chain
-
-        // These two vectors are indexed wrt LepLepId enum
-        BRANCH(gen_b_deltaR, std::vector<std::vector<float>>); // DeltaR between the gen b coming from the top decay and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
-        BRANCH(gen_bbar_deltaR, std::vector<std::vector<float>>); // DeltaR between the gen bbar coming from the anti-top decay chain and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
-
-        // These two vectors are indexed wrt LepLepId enum
-        BRANCH(gen_b_beforeFSR_deltaR, std::vector<std::vector<float>>); // DeltaR between the gen b coming from the top decay and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
-        BRANCH(gen_bbar_beforeFSR_deltaR, std::vector<std::vector<float>>); // DeltaR between the gen bbar coming from the anti-top decay chain and each selected jets. Indexed as `selectedJets_tightID_DRcut` array
-
-        BRANCH(gen_lepton_t_deltaR, std::vector<float>); // DeltaR between the gen lepton coming from the top decay chain and each selected lepton. Indexed as `leptons` array
-        BRANCH(gen_lepton_tbar_deltaR, std::vector<float>); // DeltaR between the gen lepton coming from the anti-top decay chain and each selected lepton. Indexed as `leptons` array
-
-        // These two vectors are indexed wrt LepLepId enum
-        BRANCH(gen_matched_b, std::vector<int8_t>); // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen b coming from the top decay
-        BRANCH(gen_matched_bbar, std::vector<int8_t>); // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen bbar coming from the anti-top decay
-
-        // These two vectors are indexed wrt LepLepId enum
-        BRANCH(gen_matched_b_beforeFSR, std::vector<int8_t>); // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen b coming from the top decay
-        BRANCH(gen_matched_bbar_beforeFSR, std::vector<int8_t>); // Index inside the `selectedJets_tightID_DRcut` collection of the jet with the smallest deltaR with the gen bbar coming from the anti-top decay
-
-        BRANCH(gen_matched_lepton_t, int16_t); // Index inside the `leptons` collection of the lepton with the smallest deltaR with the gen lepton coming from the top decay chain
-        BRANCH(gen_matched_lepton_tbar, int16_t); // Index inside the `leptons` collection of the lepton with the smallest deltaR with the gen lepton coming from the anti-top decay chain
+        // One branch for each output of the analysis, see EventOutputsList.h
+#define TT_OUTPUT(NAME, ...) OPTIONAL_BRANCH(NAME, __VA_ARGS__);
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+        // Not stored in the tree: used by the categories (see TTAnalysis::EventOutputs)
+        const std::array<TTAnalysis::DiLeptonSummary, TTAnalysis::LepID::Count * TTAnalysis::LepIso::Count * TTAnalysis::LepID::Count * TTAnalysis::LepIso::Count>& diLeptons_summary = m_core.diLeptons_summary;
+        const uint8_t& diLeptons_flavours = m_core.diLeptons_flavours;
 
     private:
 
+        /*
+         * Configuration: set once in the constructor and only read afterwards.
+         * Everything mutable below is owned by this instance and only touched from `analyze`,
+         * so that one instance per stream can process events concurrently.
+         */
+
         // Producers name
         const std::string m_electrons_producer;
         const std::string m_muons_producer;
         const std::string m_jets_producer;
         const std::string m_met_producer;
 
-        const float m_electronPtCut, m_electronEtaCut;
         const std::string m_electronVetoIDName;
         const std::string m_electronLooseIDName;
         const std::string m_electronMediumIDName;
         const std::string m_electronTightIDName;
+        const std::string m_jetCSVv2Name;
+        const std::string m_histogramsFile;
+        const bool m_histogramsWeighted;
+        const std::string m_event_producer;
 
-        const float m_muonPtCut, m_muonEtaCut, m_muonLooseIsoCut, m_muonTightIsoCut;
-
-        const float m_jetPtCut, m_jetEtaCut, m_bJetEtaCut, m_jetPUID, m_jetDRleptonCut;
-        const std::string m_jetID, m_jetCSVv2Name;
-        const float m_jetCSVv2L, m_jetCSVv2M, m_jetCSVv2T;
-
-        const float m_hltDRCut, m_hltDPtCut;
-
-        std::shared_ptr<NeutrinosSolver> m_neutrinos_solver;
-
-        static inline bool muonIDAccessor(const MuonsProducer& muons, const uint16_t index, const std::string& muonID){
-            if(index >= muons.p4.size())
-              throw edm::Exception(edm::errors::StdException, "Invalid muon index passed to ID accessor");
-
-            if(muonID == "loose")
-                return muons.isLoose[index];
-            
-            if(muonID == "medium")
-                return muons.isMedium[index];
-            
-            if(muonID == "tight")
-                return muons.isTight[index];
-            
-            throw edm::Exception(edm::errors::NotFound, "Unknown muonID passed to analyzer");
-        }
-        
-        static inline bool jetIDAccessor(const JetsProducer& jets, const uint16_t index, const std::string& jetID){
-            if(index >= jets.p4.size())
-              throw edm::Exception(edm::errors::StdException, "Invalid jet index passed to ID accessor");
-            
-            if(jetID == "loose")
-                return jets.passLooseID[index];
-            
-            if(jetID == "tight")
-                return jets.passTightID[index];
-            
-            if(jetID == "tightLeptonVeto")
-                return jets.passTightLeptonVetoID[index];
-            
-            throw edm::Exception(edm::errors::NotFound, "Unknown jetID passed to analyzer");
+        bool isBranchEnabled(const std::string& name) const {
+            return !m_disabledBranches.count(name);
         }
-};
 
+        static std::set<std::string> expandBranchGroups(const std::vector<std::string>& names);
+        static std::set<std::string> disabledBranches(const edm::ParameterSet& config);
+        static TTAnalysis::AnalysisConfig analysisConfig(const edm::ParameterSet& config, const std::set<std::string>& disabledBranches);
+        static TTAnalysis::JetID::JetID jetID(const std::string& name);
+        static std::vector<TTAnalysis::HistogramConfig> histogramConfigs(const edm::ParameterSet& config);
+
+        /*
+         * Jet systematic variation (e.g. JEC/JER up/down) processed in the same analyzer as the nominal jets:
+         * the leptons, trigger matching and gen-level information are shared, and only the jet-dependent
+         * outputs (TT_JET_OUTPUT in EventOutputsList.h) are recomputed, in branches suffixed with `_<name>`.
+         */
+        struct JetSystematic {
+            JetSystematic(const edm::ParameterSet& config, const std::string& nominal_met_producer, ROOT::TreeGroup& tree, const std::set<std::string>& disabledBranches);
+
+            const std::string name;
+            const std::string jets_producer;
+            const std::string met_producer; // Same as the nominal one if not set
+
+#define TT_OUTPUT(NAME, ...)
+#define TT_JET_OUTPUT(NAME, ...) __VA_ARGS__* NAME;
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_JET_OUTPUT
+#undef TT_OUTPUT
+        };
+
+        void fillInputs(const edm::Event& event, const ProducersManager& producers);
+        double histogramsWeight(const edm::Event& event, const ProducersManager& producers) const;
+        void fillJetsInputs(const std::string& jets_producer, const ProducersManager& producers, TTAnalysis::JetsInputs& inputs) const;
+        void moveOutputs();
+        void moveJetOutputs();
+        void moveJetOutputs(JetSystematic& systematic);
+
+        std::vector<JetSystematic> m_jetSystematics;
+        TTAnalysis::JetsInputs m_systematic_jets;
+
+        // Inputs of the current event, kept across events to reuse their allocations
+        TTAnalysis::EventInputs m_inputs;
+
+        // Capture of the inputs (null if `captureFile` is not set), shared by the instances writing to the same file
+        std::shared_ptr<TTAnalysis::EventCaptureWriter> m_capture;
+
+        // Histograms of the nominal outputs (null if `histograms` is empty), added to `histogramsFile` by `endJob`
+        std::unique_ptr<TTAnalysis::HistogramAggregator> m_histograms;
+        std::shared_ptr<TTAnalysis::HistogramsFile> m_histogramsOutput;
+
+        // Sizes of the nominal outputs of each event (null if `sizeReportEvents` is 0)
+        std::unique_ptr<TTAnalysis::OutputsSizeMonitor> m_outputsSize;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cp3_llbb/TTAnalysis/interface/NeutrinosSolver.h>
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Resolution-smeared reconstruction of the ttbar system: the lepton and b-jet energies and the MET are sampled within their resolutions,
+   * and each sample is solved for both b-jet assignments. Candidates without any solution for their measured momenta often get some
+   * for part of the samples. The samples of a candidate are drawn from a RandomStream seeded by the caller, and solved as one batch.
+   */
+  class TTBarSmearing {
+    public:
+      struct Settings {
+        size_t samples = 100; // At most 65535
+        float leptonResolution = 0.02; // Relative energy resolutions
+        float jetResolution = 0.1;
+        float metResolution = 10; // Resolution of each MET component, not due to the leptons and b-jets (GeV)
+      };
+
+      explicit TTBarSmearing(const Settings& settings);
+
+      // The energies are scaled, keeping the directions and the mass over energy ratios. The MET is corrected for the scaled objects.
+      TTBarSmeared reconstruct(const NeutrinosSolver& solver, uint16_t diLepDiJetIdx, uint64_t seed,
+          const NeutrinosSolver::LorentzVector& lepton1_p4, const NeutrinosSolver::LorentzVector& lepton2_p4,
+          const NeutrinosSolver::LorentzVector& bjet1_p4, const NeutrinosSolver::LorentzVector& bjet2_p4,
+          const NeutrinosSolver::LorentzVector& met_p4);
+
+      // Configurations solved, and rejected by the solver as above the m_lb endpoint (see NeutrinosSolver::AboveMlbEndpoint), by the last call to `reconstruct`
+      size_t solved() const {
+        return m_batch.size() - m_rejected;
+      }
+      size_t rejected() const {
+        return m_rejected;
+      }
+
+    private:
+      const Settings m_settings;
+
+      // Scratch, kept across calls to reuse its allocations
+      std::vector<NeutrinosSolver::Configuration> m_batch;
+      std::vector<uint32_t> m_batch_sample; // Sample of each configuration of the batch
+      std::vector<float> m_sample_mtt; // Lowest mtt of each sample, 0 if it has no solution
+      NeutrinosSolver::SolutionTable m_table;
+      size_t m_rejected = 0;
+  };
+
+}
@@ -7,6 +7,8 @@
 #include <cp3_llbb/Framework/interface/Category.h>
 #include <cp3_llbb/Framework/interface/HLTProducer.h>
 
+#include <cp3_llbb/TTAnalysis/interface/Indices.h>
+
 namespace TTAnalysis{
 
 class DileptonCategory: public Category {
@@ -35,7 +37,19 @@ class DileptonCategory: public Category {
       baseStrMllCut("Mll"),
       baseStrMllZVetoCut("MllZVeto"),
       baseStrDiLeptonIsOS("DiLeptonIsOS")
-      {}
+      {
+        // Cut name postfixes, indexed as the lepton ID/Iso combinations
+        m_postFix.resize(LepID::Count * LepIso::Count * LepID::Count * LepIso::Count);
+        for(const LepID::LepID& id1: LepID::it) {
+          for(const LepID::LepID& id2: LepID::it) {
+            for(const LepIso::LepIso& iso1: LepIso::it) {
+              for(const LepIso::LepIso& iso2: LepIso::it) {
+                m_postFix[LepLepIDIso(id1, iso1, id2, iso2)] = "_" + LepLepIDIsoStr(id1, iso1, id2, iso2);
+              }
+            }
+          }
+        }
+      }
 
   protected:
     float m_MllCutSF, m_MllCutDF, m_MllZVetoCutLow, m_MllZVetoCutHigh;
@@ -51,6 +65,8 @@ class DileptonCategory: public Category {
     std::string baseStrMllZVetoCut;
     std::string baseStrDiLeptonIsOS;
 
+    std::vector<std::string> m_postFix;
+
     std::vector<boost::regex> m_HLTDoubleMuonRegex;
     std::vector<boost::regex> m_HLTDoubleEGRegex;
     std::vector<boost::regex> m_HLTMuonEGRegex;
@@ -104,6 +120,15 @@ class DileptonCategory: public Category {
 
       return commonMatchedTriggers.size() > 0;
     }
+
+    // Shared implementation of the four categories, reading the per-event DiLepton summary filled by the analyzer
+
+    // True if the leading DiLepton of at least one ID/Iso combination has the requested flavour
+    bool diLeptonFlavourInCategory(const AnalyzersManager& analyzers, DiLepFlavour::DiLepFlavour flavour) const;
+
+    void registerDiLeptonCuts(CutManager& manager) const;
+
+    void evaluateDiLeptonCuts(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers, DiLepFlavour::DiLepFlavour flavour, float MllCut, HLT pathGroup) const;
       
 };
 
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TTAnalysis {
+
+  /*
+   * Fixed set of worker threads running jobs, with one queue per thread. A worker first runs the most recent jobs
+   * it submitted itself (they use the data it just produced), and steals the oldest jobs of the other queues when its own is empty.
+   * A thread waiting for jobs to complete helps running them (see runUntil) instead of blocking.
+   */
+  class TaskPool {
+    public:
+      using Job = std::function<void()>;
+
+      // Jobs must not throw
+      explicit TaskPool(size_t threads);
+      ~TaskPool();
+
+      TaskPool(const TaskPool&) = delete;
+      TaskPool& operator=(const TaskPool&) = delete;
+
+      size_t threads() const {
+        return m_workers.size();
+      }
+
+      void submit(Job job);
+
+      // Run the queued jobs, or wait for new ones, until `done` returns true.
+      // The job making `done` true must call notify() afterwards.
+      void runUntil(const std::function<bool()>& done);
+
+      // Wake up the threads waiting in runUntil
+      void notify();
+
+    private:
+      struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+      };
+
+      // One queue per worker, and a last one for the jobs submitted by the other threads
+      std::vector<std::unique_ptr<Queue>> m_queues;
+      std::vector<std::thread> m_workers;
+
+      std::mutex m_sleep_mutex;
+      std::condition_variable m_wake;
+      std::atomic<size_t> m_queued{0};
+      bool m_stop = false;
+
+      size_t currentQueue() const;
+      bool pop(size_t queue, Job& job);
+      void work(size_t queue);
+  };
+
+  /*
+   * Stages of a computation and their dependencies. They are run either sequentially, in the order they were added,
+   * or concurrently on a TaskPool, each one as soon as its dependencies are done.
+   * A stage must not write anything read or written by a stage which is neither one of its dependencies (direct or not) nor depends on it:
+   * the results are then the same for any scheduling.
+   */
+  class TaskGraph {
+    public:
+      using Stage = size_t;
+
+      // The dependencies must already have been added, so that the order of addition is a valid sequential order
+      Stage add(std::function<void()> function, std::initializer_list<Stage> dependencies = {});
+
+      // Run all the stages once, sequentially if `pool` is null or has no thread.
+      // If a stage throws, the stages not started yet are skipped and the first exception is rethrown.
+      void run(TaskPool* pool);
+
+    private:
+      struct Node {
+        std::function<void()> function;
+        std::vector<Stage> dependents;
+        size_t dependencies;
+      };
+      std::vector<Node> m_nodes;
+
+      // State of a concurrent run
+      TaskPool* m_pool = nullptr;
+      std::vector<std::atomic<size_t>> m_pending; // Dependencies of each stage not done yet
+      std::atomic<size_t> m_remaining{0}; // Stages not done yet
+      std::atomic<bool> m_failed{false};
+      std::mutex m_error_mutex;
+      std::exception_ptr m_error;
+
+      void submit(Stage stage);
+      void execute(Stage stage);
+  };
+
+}
@@ -0,0 +1,17 @@
+// No include guard: this file is included several times.
+//
+// Counts of TTAnalysis::Telemetry, as TT_TELEMETRY(name, type) entries.
+// Define TT_TELEMETRY before including this file: Types.h declares the members of TTAnalysis::Telemetry,
+// and TelemetrySummary and OutputsComparison handle each of them.
+
+TT_TELEMETRY(leptons, uint16_t)
+TT_TELEMETRY(diLeptons, uint16_t)
+TT_TELEMETRY(selJets, uint16_t)
+TT_TELEMETRY(diJets, uint16_t)
+TT_TELEMETRY(diLepDiJets, uint32_t) // Only counted if they are built
+TT_TELEMETRY(neutrinosCalls, uint32_t) // Calls to NeutrinosSolver::getNeutrinos, two per candidate of the ttbar reconstruction
+TT_TELEMETRY(neutrinosSolutions, uint32_t) // Solutions found by these calls
+TT_TELEMETRY(neutrinosFailures, uint32_t) // Calls without any solution, besides the rejected ones
+TT_TELEMETRY(neutrinosRejected, uint32_t) // Calls rejected by the solver, being above the m_lb endpoint (see NeutrinosSolver::AboveMlbEndpoint)
+TT_TELEMETRY(neutrinosSmeared, uint32_t) // Configurations solved by the resolution-smeared reconstruction (see AnalysisConfig::ttbarSmearingSamples)
+TT_TELEMETRY(neutrinosSmearedRejected, uint32_t) // Smeared configurations not solved, being above the m_lb endpoint
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+
+namespace TTAnalysis {
+
+  /*
+   * Distribution of each Telemetry count over the events, in power-of-two bins: 0, 1, 2-3, 4-7, ...
+   * The last bin also holds the larger values.
+   */
+  class TelemetrySummary {
+    public:
+      static const size_t Bins = 16;
+
+      void add(const Telemetry& telemetry);
+
+      // Mean, maximum, total and non-empty bins of each count
+      void print(std::ostream& out) const;
+
+      uint64_t events() const {
+        return m_events;
+      }
+
+    private:
+      struct Distribution {
+        uint64_t sum = 0;
+        uint32_t max = 0;
+        std::array<uint64_t, Bins> bins{};
+
+        void add(uint32_t value);
+      };
+
+      // Members of Telemetry, in declaration order
+#define TT_TELEMETRY(NAME, TYPE) + 1
+      static const size_t Counts = 0
+#include <cp3_llbb/TTAnalysis/interface/TelemetryList.h>
+      ;
+#undef TT_TELEMETRY
+      static const std::array<const char*, Counts> s_names;
+
+      uint64_t m_events = 0;
+      std::array<Distribution, Counts> m_distributions;
+  };
+
+}
@@ -1,42 +1,67 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
 #include <cp3_llbb/TTAnalysis/interface/Types.h>
-#include <cp3_llbb/Framework/interface/JetsProducer.h>
+#include <cp3_llbb/TTAnalysis/interface/Column.h>
 
 namespace TTAnalysis {
   
   float DeltaEta(const myLorentzVector &v1, const myLorentzVector &v2);
+
+  // Round `value` to the nearest float having only `bits` significant bits in its mantissa (out of 23).
+  // The result is still a float, but the zeroed low bits compress much better in the output files.
+  // The relative precision is 2^-(bits+1): 7 bits give better than 0.4%.
+  // Values which would round up to infinity, such as the std::numeric_limits<float>::max() defaults, are returned unchanged.
+  inline float truncateMantissa(float value, uint8_t bits) {
+    if(bits >= 23 || !std::isfinite(value))
+      return value;
+
+    uint32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+
+    const uint32_t dropped = 23 - bits;
+    word += 1u << (dropped - 1); // round to nearest
+    word &= ~((1u << dropped) - 1);
+    if((word & 0x7f800000) == 0x7f800000)
+      return value;
+
+    std::memcpy(&value, &word, sizeof(word));
+    return value;
+  }
   
   // Used by std::sort to sort jets according to decreasing b-tagging discriminant value
+  // `discriminants` is indexed as the input jets (see JetsInputs::CSVv2)
   class jetBTagDiscriminantSorter {
     
     public:
  
-      // Either use indices to jets producer
-      jetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName): 
-        m_jetsProducer(&jets),
-        m_taggerName(taggerName),
+      // Either use indices to input jets
+      jetBTagDiscriminantSorter(const Column<float>& discriminants): 
+        m_discriminants(discriminants),
         m_jetsArray(nullptr)
         {}
 
       // Or use indices to Jets array
-      jetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName, const std::vector<Jet>& tt_jets): 
-        m_jetsProducer(&jets),
-        m_taggerName(taggerName),
+      jetBTagDiscriminantSorter(const Column<float>& discriminants, const std::vector<Jet>& tt_jets): 
+        m_discriminants(discriminants),
         m_jetsArray(&tt_jets)
         {}
       
       bool operator()(uint16_t idxJet1, uint16_t idxJet2){
         if(!m_jetsArray)
-          return m_jetsProducer->getBTagDiscriminant(idxJet1, m_taggerName) > m_jetsProducer->getBTagDiscriminant(idxJet2, m_taggerName);
+          return m_discriminants[idxJet1] > m_discriminants[idxJet2];
         else
-          return m_jetsProducer->getBTagDiscriminant(m_jetsArray->at(idxJet1).idx, m_taggerName) > m_jetsProducer->getBTagDiscriminant(m_jetsArray->at(idxJet2).idx, m_taggerName);
+          return m_discriminants[m_jetsArray->at(idxJet1).idx] > m_discriminants[m_jetsArray->at(idxJet2).idx];
       }
   
     private:
   
-      const JetsProducer* const m_jetsProducer;
-      const std::string m_taggerName;
+      const Column<float>& m_discriminants;
       const std::vector<Jet>* const m_jetsArray;
 
   };
@@ -48,38 +73,34 @@ namespace TTAnalysis {
  
       // Either work directly on DiJet objects
 
-      diJetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName): 
-        m_jetsProducer(jets), 
-        m_taggerName(taggerName) 
+      diJetBTagDiscriminantSorter(const Column<float>& discriminants): 
+        m_discriminants(discriminants) 
         {}
       
       bool operator()(const DiJet& diJet1, const DiJet& diJet2){
         return 
-          ( m_jetsProducer.getBTagDiscriminant(diJet1.idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant(diJet1.idxs.second, m_taggerName) ) > 
-          ( m_jetsProducer.getBTagDiscriminant(diJet2.idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant(diJet2.idxs.second, m_taggerName) );
+          ( m_discriminants[diJet1.idxs.first] + m_discriminants[diJet1.idxs.second] ) > 
+          ( m_discriminants[diJet2.idxs.first] + m_discriminants[diJet2.idxs.second] );
       }
 
       // Or work on vectors containing indices pointing to jets themselves
       // 1) Using DiJets
-      diJetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName, const std::vector<DiJet>& diJets):  
-        m_jetsProducer(jets), 
-        m_taggerName(taggerName), 
+      diJetBTagDiscriminantSorter(const Column<float>& discriminants, const std::vector<DiJet>& diJets):  
+        m_discriminants(discriminants), 
         m_diJets(&diJets), 
         m_diLepDiJets(nullptr), 
         m_diLepDiJetsMet(nullptr) 
         {}
       // 2) Using DiLepDiJets
-      diJetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName, const std::vector<DiLepDiJet>& diLepDiJets):  
-        m_jetsProducer(jets), 
-        m_taggerName(taggerName), 
+      diJetBTagDiscriminantSorter(const Column<float>& discriminants, const std::vector<DiLepDiJet>& diLepDiJets):  
+        m_discriminants(discriminants), 
         m_diJets(nullptr), 
         m_diLepDiJets(&diLepDiJets), 
         m_diLepDiJetsMet(nullptr) 
         {}
       // 3) Using DiLepDiJetsMet
-      diJetBTagDiscriminantSorter(const JetsProducer& jets, const std::string& taggerName, const std::vector<DiLepDiJetMet>& diLepDiJetsMet):  
-        m_jetsProducer(jets), 
-        m_taggerName(taggerName), 
+      diJetBTagDiscriminantSorter(const Column<float>& discriminants, const std::vector<DiLepDiJetMet>& diLepDiJetsMet):  
+        m_discriminants(discriminants), 
         m_diJets(nullptr), 
         m_diLepDiJets(nullptr), 
         m_diLepDiJetsMet(&diLepDiJetsMet) 
@@ -89,18 +110,18 @@ namespace TTAnalysis {
         
         if(m_diJets){
           return 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diJets)[idx1].idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diJets)[idx1].idxs.second, m_taggerName) ) > 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diJets)[idx2].idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diJets)[idx2].idxs.second, m_taggerName) );
+            ( m_discriminants[(*m_diJets)[idx1].idxs.first] + m_discriminants[(*m_diJets)[idx1].idxs.second] ) > 
+            ( m_discriminants[(*m_diJets)[idx2].idxs.first] + m_discriminants[(*m_diJets)[idx2].idxs.second] );
         
         }else if(m_diLepDiJets){
           return 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diLepDiJets)[idx1].diJet->idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diLepDiJets)[idx1].diJet->idxs.second, m_taggerName) ) > 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diLepDiJets)[idx2].diJet->idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diLepDiJets)[idx2].diJet->idxs.second, m_taggerName) );
+            ( m_discriminants[(*m_diLepDiJets)[idx1].diJet->idxs.first] + m_discriminants[(*m_diLepDiJets)[idx1].diJet->idxs.second] ) > 
+            ( m_discriminants[(*m_diLepDiJets)[idx2].diJet->idxs.first] + m_discriminants[(*m_diLepDiJets)[idx2].diJet->idxs.second] );
         
         }else if(m_diLepDiJetsMet){
           return 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diLepDiJetsMet)[idx1].diJet->idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diLepDiJetsMet)[idx1].diJet->idxs.second, m_taggerName) ) > 
-            ( m_jetsProducer.getBTagDiscriminant((*m_diLepDiJetsMet)[idx2].diJet->idxs.first, m_taggerName) + m_jetsProducer.getBTagDiscriminant((*m_diLepDiJetsMet)[idx2].diJet->idxs.second, m_taggerName) );
+            ( m_discriminants[(*m_diLepDiJetsMet)[idx1].diJet->idxs.first] + m_discriminants[(*m_diLepDiJetsMet)[idx1].diJet->idxs.second] ) > 
+            ( m_discriminants[(*m_diLepDiJetsMet)[idx2].diJet->idxs.first] + m_discriminants[(*m_diLepDiJetsMet)[idx2].diJet->idxs.second] );
         
         }else{
           return false;
@@ -109,12 +130,36 @@ namespace TTAnalysis {
     
     private:
   
-      const JetsProducer& m_jetsProducer;
-      const std::string m_taggerName;
-      const std::vector<DiJet>* m_diJets; 
-      const std::vector<DiLepDiJet>* m_diLepDiJets; 
-      const std::vector<DiLepDiJetMet>* m_diLepDiJetsMet; 
+      const Column<float>& m_discriminants;
+      const std::vector<DiJet>* m_diJets = nullptr; 
+      const std::vector<DiLepDiJet>* m_diLepDiJets = nullptr; 
+      const std::vector<DiLepDiJetMet>* m_diLepDiJetsMet = nullptr; 
   };
 
+  // Only keep the first `max` indices of `candidates` (0 keeps all of them)
+  inline void keepCandidates(std::vector<uint16_t>& candidates, size_t max) {
+    if(max && max < candidates.size())
+      candidates.resize(max);
+  }
+
+  // Sort the indices of `candidates` with one of the sorters above, only keeping the first `max` ones (0 keeps all of them).
+  // The candidates are filled by increasing index: the index breaks the ties, so that a capped list is the beginning of the full one.
+  template <typename Sorter>
+  void sortCandidates(std::vector<uint16_t>& candidates, size_t max, Sorter sorter) {
+    auto sorterByIndex = [&sorter](uint16_t a, uint16_t b) {
+      if(sorter(a, b))
+        return true;
+      return !sorter(b, a) && a < b;
+    };
+
+    if(!max || max >= candidates.size()){
+      std::sort(candidates.begin(), candidates.end(), sorterByIndex);
+      return;
+    }
+
+    std::partial_sort(candidates.begin(), candidates.begin() + max, candidates.end(), sorterByIndex);
+    keepCandidates(candidates, max);
+  }
+
 }
 
@@ -1,10 +1,12 @@
 #pragma once
 
-#include <utility>
-#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <limits>
+#include <type_traits>
 
 #include <Math/PtEtaPhiE4D.h>
+#include <Math/PxPyPzE4D.h>
 #include <Math/LorentzVector.h>
 #include <Math/VectorUtil.h>
 
@@ -13,16 +15,39 @@
 
 // Needed because of gcc bug when using typedef and std::map
 #define myLorentzVector ROOT::Math::LorentzVector<ROOT::Math::PtEtaPhiE4D<float>>
+// Cartesian version, used to add four-vectors without going through the polar coordinates
+#define myCartesianVector ROOT::Math::LorentzVector<ROOT::Math::PxPyPzE4D<float>>
 
 namespace TTAnalysis {
 
   // Forward declaration to use this here
   float DeltaEta(const myLorentzVector &v1, const myLorentzVector &v2);
 
+  /*
+   * The objects below are plain structures: no virtual functions and only fixed-size members,
+   * so that they are trivially copyable (as long as ROOT's Lorentz vectors are).
+   * Their collections can be block-copied, and ROOT can split them member-wise.
+   */
+
+  // Replacement for std::pair, which is not trivially copyable. Value-initialized by default, as std::pair.
+  template<typename T>
+  struct IndexPair {
+    IndexPair(): first(), second() {}
+    IndexPair(T first, T second): first(first), second(second) {}
+
+    T first;
+    T second;
+  };
+
+  /*
+   * Composite objects are built by adding the cartesian four-vectors of their constituents, and only the sum
+   * is converted to p4: each object costs a single conversion between the polar and cartesian coordinates.
+   * The cartesian four-vectors are not kept in the objects, but next to their collections by AnalysisCore.
+   */
   struct BaseObject {
-    BaseObject(myLorentzVector p4): p4(p4) {}
+    BaseObject(const myLorentzVector& p4): p4(p4) {}
+    explicit BaseObject(const myCartesianVector& cartesian_p4): p4(cartesian_p4) {}
     BaseObject() {}
-    virtual ~BaseObject() {}
 
     myLorentzVector p4;
   };
@@ -36,20 +61,20 @@ namespace TTAnalysis {
   };
 
   struct Lepton: BaseObject {
-    Lepton():
-      ID(LepID::Count, false),
-      iso(LepIso::Count, false)
-    {}
+    Lepton() {
+      std::fill(std::begin(ID), std::end(ID), false);
+      std::fill(std::begin(iso), std::end(iso), false);
+    }
     Lepton(myLorentzVector p4, uint16_t idx, uint16_t charge, bool isEl, bool isMu, bool isVeto = false, bool isLoose = false, bool isMedium = false, bool isTight = false, float isoValue = 0, bool isoLoose = false, bool isoTight = false):
       BaseObject(p4), 
       idx(idx), 
       charge(charge),
       isoValue(isoValue),
       isEl(isEl), 
-      isMu(isMu),
-      ID(LepID::Count, false),
-      iso(LepIso::Count, false)
+      isMu(isMu)
       {
+        std::fill(std::begin(iso), std::end(iso), false);
+
         if(isEl)
           ID[LepID::V] = isVeto;
         else
@@ -72,14 +97,12 @@ namespace TTAnalysis {
     int16_t hlt_idx = -1; // Index to the matched HLT object. -1 if no match
     bool isEl;
     bool isMu;
-    std::vector<bool> ID; // lepton ID: veto-loose-medium-tight
-    std::vector<bool> iso; // lepton Iso: loose-tight (only for muons -> electrons only have loose)
+    bool ID[LepID::Count]; // lepton ID: veto-loose-medium-tight
+    bool iso[LepIso::Count]; // lepton Iso: loose-tight (only for muons -> electrons only have loose)
 
     float hlt_DR_matched_object;
     float hlt_DPt_matched_object;
 
-    bool hlt_already_tried_matching = false; // Internal flag; if true, it means this lepton has already been matched to an online object, even if no match has been found.
-
     int8_t pdg_id() const {
         int8_t id = (isEl) ? 11 : 13;
         return charge * id;
@@ -87,48 +110,70 @@ namespace TTAnalysis {
   };
   
   struct DiLepton: BaseObject {
-    DiLepton():
-      ID(LepID::Count*LepID::Count, false),
-      iso(LepIso::Count*LepIso::Count, false)
-      {}
+    DiLepton() {
+      std::fill(std::begin(ID), std::end(ID), false);
+      std::fill(std::begin(iso), std::end(iso), false);
+    }
     
-    std::pair<uint16_t, uint16_t> idxs; // stores indices to electron/muon arrays
-    std::pair<uint16_t, uint16_t> lidxs; // stores indices to Lepton array
-    std::pair<int16_t, int16_t> hlt_idxs; // Stores indices of matched online objects
+    IndexPair<uint16_t> idxs; // stores indices to electron/muon arrays
+    IndexPair<uint16_t> lidxs; // stores indices to Lepton array
+    IndexPair<int16_t> hlt_idxs; // Stores indices of matched online objects
     bool isElEl, isElMu, isMuEl, isMuMu;
     bool isOS; // opposite sign
     bool isSF; // same flavour
-    std::vector<bool> ID; // combination of two lepton IDs
-    std::vector<bool> iso; // combination of two lepton isolations
+    bool ID[LepID::Count*LepID::Count]; // combination of two lepton IDs
+    bool iso[LepIso::Count*LepIso::Count]; // combination of two lepton isolations
     float DR;
     float DEta;
     float DPhi;
+
+    DiLepFlavour::DiLepFlavour flavour() const {
+      if(isElEl)
+        return DiLepFlavour::ElEl;
+      if(isElMu)
+        return DiLepFlavour::ElMu;
+      if(isMuEl)
+        return DiLepFlavour::MuEl;
+      return DiLepFlavour::MuMu;
+    }
+  };
+
+  // Leading DiLepton of one lepton ID/Iso combination, as needed by the categories.
+  // Filled once per event by the analyzer (not stored in the tree).
+  struct DiLeptonSummary {
+    int16_t diLepIdx = -1; // index to the leading DiLepton in the DiLeptons array, -1 if there is none
+    uint16_t nDiLeptons = 0; // number of DiLeptons passing this ID/Iso combination
+    DiLepFlavour::DiLepFlavour flavour = DiLepFlavour::Count;
+    float Mll = 0;
+    bool isOS = false;
+    bool hltMatched = false; // both leptons are matched to an online object
+    IndexPair<int16_t> hlt_idxs = IndexPair<int16_t>(-1, -1);
   };
- 
+
   struct Jet: BaseObject {
-    Jet():
-      ID(JetID::Count, false),
-      minDRjl_lepIDIso(LepID::Count*LepIso::Count, std::numeric_limits<float>::max()),
-      BWP(BWP::Count, false)
-      {}
+    Jet() {
+      std::fill(std::begin(ID), std::end(ID), false);
+      std::fill(std::begin(minDRjl_lepIDIso), std::end(minDRjl_lepIDIso), std::numeric_limits<float>::max());
+      std::fill(std::begin(BWP), std::end(BWP), false);
+    }
 
     uint16_t idx; // index to jet array
-    std::vector<bool> ID;
-    std::vector<float> minDRjl_lepIDIso; // defined for each combination of a lepton ID and isolation
+    bool ID[JetID::Count];
+    float minDRjl_lepIDIso[LepID::Count*LepIso::Count]; // defined for each combination of a lepton ID and isolation
     float CSVv2;
-    std::vector<bool> BWP;
+    bool BWP[BWP::Count];
   };
   
   struct DiJet: BaseObject {
-    DiJet():
-      minDRjl_lepIDIso(LepID::Count*LepIso::Count, std::numeric_limits<float>::max()),
-      BWP(BWP::Count*BWP::Count, false)
-      {}
+    DiJet() {
+      std::fill(std::begin(minDRjl_lepIDIso), std::end(minDRjl_lepIDIso), std::numeric_limits<float>::max());
+      std::fill(std::begin(BWP), std::end(BWP), false);
+    }
     
-    std::pair<uint16_t, uint16_t> idxs; // stores indices to jets array
-    std::pair<uint16_t, uint16_t> jidxs; // stores indices to TTAnalysis::Jet array
-    std::vector<float> minDRjl_lepIDIso; // defined for each combination of a lepton ID and isolation
-    std::vector<bool> BWP; // combination of two b-tagging working points
+    IndexPair<uint16_t> idxs; // stores indices to jets array
+    IndexPair<uint16_t> jidxs; // stores indices to TTAnalysis::Jet array
+    float minDRjl_lepIDIso[LepID::Count*LepIso::Count]; // defined for each combination of a lepton ID and isolation
+    bool BWP[BWP::Count*BWP::Count]; // combination of two b-tagging working points
     float DR;
     float DEta;
     float DPhi;
@@ -139,8 +184,9 @@ namespace TTAnalysis {
       diLepton(nullptr),
       diJet(nullptr)
       {}
-    DiLepDiJet(const DiLepton& _diLepton, const int diLepIdx, const DiJet& _diJet, const int diJetIdx):
-      BaseObject(_diLepton.p4 + _diJet.p4),
+    // `cartesian_p4` is the sum of the dilepton and the dijet in cartesian coordinates
+    DiLepDiJet(const DiLepton& _diLepton, const int diLepIdx, const DiJet& _diJet, const int diJetIdx, const myCartesianVector& cartesian_p4):
+      BaseObject(cartesian_p4),
       diLepton(&_diLepton),
       diLepIdx(diLepIdx),
       diJet(&_diJet),
@@ -157,26 +203,21 @@ namespace TTAnalysis {
 
     float DR_ll_jj, DEta_ll_jj, DPhi_ll_jj;
     
-    float minDRjl, maxDRjl;
-    float minDEtajl, maxDEtajl;
-    float minDPhijl, maxDPhijl;
+    // Only filled if the DiLepDiJets or DiLepDiJetsMet are stored
+    float minDRjl = 0, maxDRjl = 0;
+    float minDEtajl = 0, maxDEtajl = 0;
+    float minDPhijl = 0, maxDPhijl = 0;
   };
 
   struct DiLepDiJetMet: DiLepDiJet {
     DiLepDiJetMet() {}
-    DiLepDiJetMet(const DiLepDiJet& diLepDiJet, uint16_t diLepDiJetIdx, const myLorentzVector& MetP4, bool hasNoHFMet = false):
-      DiLepDiJet(*diLepDiJet.diLepton, diLepDiJet.diLepIdx, *diLepDiJet.diJet, diLepDiJet.diJetIdx),
+    // `cartesian_p4` is the sum of the DiLepDiJet and the MET in cartesian coordinates
+    DiLepDiJetMet(const DiLepDiJet& diLepDiJet, uint16_t diLepDiJetIdx, const myCartesianVector& cartesian_p4, const myLorentzVector& MetP4, bool hasNoHFMet = false):
+      DiLepDiJet(diLepDiJet),
       diLepDiJetIdx(diLepDiJetIdx),
       hasNoHFMet(hasNoHFMet)
     {
-      DiLepDiJet::minDRjl = diLepDiJet.minDRjl;
-      DiLepDiJet::maxDRjl = diLepDiJet.maxDRjl;
-      DiLepDiJet::minDEtajl = diLepDiJet.minDEtajl;
-      DiLepDiJet::maxDEtajl = diLepDiJet.maxDEtajl;
-      DiLepDiJet::minDPhijl = diLepDiJet.minDPhijl;
-      DiLepDiJet::maxDPhijl = diLepDiJet.maxDPhijl;
-      
-      p4 += MetP4;
+      p4 = myLorentzVector(cartesian_p4);
 
       DR_ll_Met = ROOT::Math::VectorUtil::DeltaR(diLepton->p4, MetP4);
       DR_jj_Met = ROOT::Math::VectorUtil::DeltaR(diJet->p4, MetP4);
@@ -187,9 +228,10 @@ namespace TTAnalysis {
       DPhi_ll_Met = ROOT::Math::VectorUtil::DeltaPhi(diLepton->p4, MetP4);
       DPhi_jj_Met = ROOT::Math::VectorUtil::DeltaPhi(diJet->p4, MetP4);
       
-      DR_lljj_Met = ROOT::Math::VectorUtil::DeltaR(diLepton->p4 + diJet->p4, MetP4);
-      DEta_lljj_Met = DeltaEta(diLepton->p4 + diJet->p4, MetP4);
-      DPhi_lljj_Met = ROOT::Math::VectorUtil::DeltaPhi(diLepton->p4 + diJet->p4, MetP4);
+      // The DiLepDiJet four-vector is the sum of the dilepton and the dijet
+      DR_lljj_Met = ROOT::Math::VectorUtil::DeltaR(diLepDiJet.p4, MetP4);
+      DEta_lljj_Met = DeltaEta(diLepDiJet.p4, MetP4);
+      DPhi_lljj_Met = ROOT::Math::VectorUtil::DeltaPhi(diLepDiJet.p4, MetP4);
     }
 
     uint16_t diLepDiJetIdx;
@@ -203,40 +245,111 @@ namespace TTAnalysis {
     float DEta_lljj_Met;
     float DPhi_lljj_Met;
 
-    float minDR_l_Met, minDR_j_Met;
-    float maxDR_l_Met, maxDR_j_Met;
-    float minDEta_l_Met, minDEta_j_Met;
-    float maxDEta_l_Met, maxDEta_j_Met;
-    float minDPhi_l_Met, minDPhi_j_Met;
-    float maxDPhi_l_Met, maxDPhi_j_Met;
+    // Only filled if the DiLepDiJetsMet are stored
+    float minDR_l_Met = 0, minDR_j_Met = 0;
+    float maxDR_l_Met = 0, maxDR_j_Met = 0;
+    float minDEta_l_Met = 0, minDEta_j_Met = 0;
+    float maxDEta_l_Met = 0, maxDEta_j_Met = 0;
+    float minDPhi_l_Met = 0, minDPhi_j_Met = 0;
+    float maxDPhi_l_Met = 0, maxDPhi_j_Met = 0;
   };
 
   struct TTBar: public BaseObject {
 
       TTBar() {}
 
-      TTBar(uint16_t index, const myLorentzVector& top1_p4_, const myLorentzVector& top2_p4_) {
+      TTBar(uint16_t index, const myLorentzVector& top1_p4_, const myLorentzVector& top2_p4_):
+          BaseObject(myCartesianVector(top1_p4_) + myCartesianVector(top2_p4_)) {
+
+          setTops(index, top1_p4_, top2_p4_);
+      }
+
+      // From the tops in cartesian coordinates, as given by the neutrinos reconstruction: the ttbar system is added before any conversion
+      TTBar(uint16_t index, const NeutrinosSolver::LorentzVector& top1, const NeutrinosSolver::LorentzVector& top2):
+          BaseObject(myCartesianVector(top1 + top2)) {
+
+          setTops(index, myLorentzVector(top1), myLorentzVector(top2));
+      }
+
+      uint16_t diLepDiJetIdx;
+
+      myLorentzVector top1_p4;
+      myLorentzVector top2_p4;
+
+      float DR_tt;
+      float DEta_tt;
+      float DPhi_tt;
+
+    private:
+      void setTops(uint16_t index, const myLorentzVector& top1_p4_, const myLorentzVector& top2_p4_) {
 
           diLepDiJetIdx = index;
 
           top1_p4 = top1_p4_;
           top2_p4 = top2_p4_;
-          p4 = top1_p4 + top2_p4;
 
           DR_tt = ROOT::Math::VectorUtil::DeltaR(top1_p4, top2_p4);
           DEta_tt = DeltaEta(top1_p4, top2_p4);
           DPhi_tt = ROOT::Math::VectorUtil::DeltaPhi(top1_p4, top2_p4);
       }
+  };
+
+  // Same as TTBar, but only storing what cannot be recomputed from the two tops
+  struct TTBarCompact {
+
+      TTBarCompact() {}
+
+      TTBarCompact(const TTBar& ttbar):
+          diLepDiJetIdx(ttbar.diLepDiJetIdx),
+          top1_p4(ttbar.top1_p4),
+          top2_p4(ttbar.top2_p4)
+      {}
+
+      // Recompute the full TTBar object, with the ttbar system and the angles between the tops
+      TTBar expand() const {
+          return TTBar(diLepDiJetIdx, top1_p4, top2_p4);
+      }
 
       uint16_t diLepDiJetIdx;
 
       myLorentzVector top1_p4;
       myLorentzVector top2_p4;
+  };
 
-      float DR_tt;
-      float DEta_tt;
-      float DPhi_tt;
+  // Resolution-smeared reconstruction of a ttbar candidate (see TTBarSmearing): mtt over the samples having a solution
+  struct TTBarSmeared {
+      uint16_t diLepDiJetIdx = 0;
+      uint16_t solvedSamples = 0; // Samples with at least one solution, for either b-jet assignment
+      float weight = 0; // Fraction of the samples with a solution
+      float mtt = 0; // Mean of the lowest mtt of each solved sample
+      float mttRMS = 0;
+  };
+
+
+  // Counts driving the processing time of an event, for capacity planning
+  struct Telemetry {
+#define TT_TELEMETRY(NAME, TYPE) TYPE NAME = 0;
+#include <cp3_llbb/TTAnalysis/interface/TelemetryList.h>
+#undef TT_TELEMETRY
   };
 
+  // Only checked if ROOT's Lorentz vectors are trivially copyable themselves (depends on the ROOT version)
+#define TT_CHECK_TRIVIALLY_COPYABLE(TYPE) \
+  static_assert(!std::is_trivially_copyable<myLorentzVector>::value || std::is_trivially_copyable<TYPE>::value, #TYPE " must be trivially copyable")
+
+  TT_CHECK_TRIVIALLY_COPYABLE(GenParticle);
+  TT_CHECK_TRIVIALLY_COPYABLE(Lepton);
+  TT_CHECK_TRIVIALLY_COPYABLE(DiLepton);
+  TT_CHECK_TRIVIALLY_COPYABLE(Jet);
+  TT_CHECK_TRIVIALLY_COPYABLE(DiJet);
+  TT_CHECK_TRIVIALLY_COPYABLE(DiLepDiJet);
+  TT_CHECK_TRIVIALLY_COPYABLE(DiLepDiJetMet);
+  TT_CHECK_TRIVIALLY_COPYABLE(TTBar);
+  TT_CHECK_TRIVIALLY_COPYABLE(TTBarCompact);
+  TT_CHECK_TRIVIALLY_COPYABLE(TTBarSmeared);
+  TT_CHECK_TRIVIALLY_COPYABLE(Telemetry);
+
+#undef TT_CHECK_TRIVIALLY_COPYABLE
+
 }
 
@@ -11,112 +11,95 @@
 using namespace TTAnalysis;
 
 // ***** ***** *****
-// Dilepton El-El category
+// Common dilepton category
 // ***** ***** *****
-bool ElElCategory::event_in_category_pre_analyzers(const ProducersManager& producers) const {
-  const ElectronsProducer& electrons = producers.get<ElectronsProducer>("electrons");
-  return electrons.p4.size() >= 2;
-}
-
-bool ElElCategory::event_in_category_post_analyzers(const ProducersManager& producers, const AnalyzersManager& analyzers) const {
+bool DileptonCategory::diLeptonFlavourInCategory(const AnalyzersManager& analyzers, DiLepFlavour::DiLepFlavour flavour) const {
   
   const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
 
-  // It at least one DiLepton of highest Pt and of type ElEl among all ID pairs is found, keep event in this category
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            if( tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ].isElEl )
-              return true;
-          }
-        
-        }
-      }
-    }
-  }
-
-  return false;
+  // If at least one DiLepton of highest Pt and of this flavour among all ID pairs is found, keep event in this category
+  return tt.diLeptons_flavours & (1 << flavour);
 }
 
-void ElElCategory::register_cuts(CutManager& manager) {
+void DileptonCategory::registerDiLeptonCuts(CutManager& manager) const {
   
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          
-          manager.new_cut(baseStrCategory + postFix, baseStrCategory + postFix);
-          manager.new_cut(baseStrExtraDiLeptonVeto + postFix, baseStrExtraDiLeptonVeto + postFix);
-          manager.new_cut(baseStrDiLeptonTriggerMatch + postFix, baseStrDiLeptonTriggerMatch + postFix);
-          manager.new_cut(baseStrMllCut + postFix, baseStrMllCut + postFix);
-          manager.new_cut(baseStrMllZVetoCut + postFix, baseStrMllZVetoCut + postFix);
-          manager.new_cut(baseStrDiLeptonIsOS + postFix, baseStrDiLeptonIsOS + postFix);
-
-        }
-      }
-    }
+  for(const std::string& postFix: m_postFix) {
+    manager.new_cut(baseStrCategory + postFix, baseStrCategory + postFix);
+    manager.new_cut(baseStrExtraDiLeptonVeto + postFix, baseStrExtraDiLeptonVeto + postFix);
+    manager.new_cut(baseStrDiLeptonTriggerMatch + postFix, baseStrDiLeptonTriggerMatch + postFix);
+    manager.new_cut(baseStrMllCut + postFix, baseStrMllCut + postFix);
+    manager.new_cut(baseStrMllZVetoCut + postFix, baseStrMllZVetoCut + postFix);
+    manager.new_cut(baseStrDiLeptonIsOS + postFix, baseStrDiLeptonIsOS + postFix);
   }
 
 }
 
-void ElElCategory::evaluate_cuts_post_analyzers(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers) const {
+void DileptonCategory::evaluateDiLeptonCuts(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers, DiLepFlavour::DiLepFlavour flavour, float MllCut, HLT pathGroup) const {
   
   const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
   const HLTProducer& hlt = producers.get<HLTProducer>("hlt");
 
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-    
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            const DiLepton& m_diLepton = tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ];
-            
-            if(m_diLepton.isElEl) {
-              manager.pass_cut(baseStrCategory + postFix);
-
-              if(m_diLepton.hlt_idxs.first >= 0 && m_diLepton.hlt_idxs.second >= 0){
-                // We have fired a trigger. Now, check that it is actually a DoubleEG trigger
-                if( checkHLT(hlt, m_diLepton.hlt_idxs.first, m_diLepton.hlt_idxs.second, HLT::DoubleEG) )
-                  manager.pass_cut(baseStrDiLeptonTriggerMatch + postFix);
-              }
-              
-              if(m_diLepton.p4.M() > m_MllCutSF)
-                manager.pass_cut(baseStrMllCut + postFix);
-              
-              if(m_diLepton.p4.M() < m_MllZVetoCutLow || m_diLepton.p4.M() > m_MllZVetoCutHigh)
-                manager.pass_cut(baseStrMllZVetoCut + postFix);
-              
-              if(m_diLepton.isOS)
-                manager.pass_cut(baseStrDiLeptonIsOS + postFix);
-            }
-          }
-          
-          // For electrons, in principe only veto using VetoID.
-          // But since the user can access any cut he wants, he can take the IDVV_IsoWhatever cut.
-          if(tt.diLeptons_IDIso[comb].size() >= 2) { 
-            manager.pass_cut(baseStrExtraDiLeptonVeto + postFix);
-          }
+  // The same leading DiLepton is shared by many combinations: only run the trigger path matching once for each of them
+  // -1: not checked yet, 0: no match, 1: match
+  std::vector<int8_t> hltMatchCache(tt.diLeptons.size(), -1);
 
-        }
+  for(uint16_t comb = 0; comb < tt.diLeptons_summary.size(); comb++) {
+    
+    const DiLeptonSummary& summary = tt.diLeptons_summary[comb];
+    const std::string& postFix = m_postFix[comb];
+
+    if(summary.diLepIdx >= 0 && summary.flavour == flavour) {
+      manager.pass_cut(baseStrCategory + postFix);
+
+      if(summary.hltMatched) {
+        // We have fired a trigger. Now, check that it is actually a trigger of the right group
+        int8_t& hltMatch = hltMatchCache[summary.diLepIdx];
+        if(hltMatch < 0)
+          hltMatch = checkHLT(hlt, summary.hlt_idxs.first, summary.hlt_idxs.second, pathGroup);
+        if(hltMatch)
+          manager.pass_cut(baseStrDiLeptonTriggerMatch + postFix);
       }
+      
+      if(summary.Mll > MllCut)
+        manager.pass_cut(baseStrMllCut + postFix);
+      
+      if(summary.Mll < m_MllZVetoCutLow || summary.Mll > m_MllZVetoCutHigh)
+        manager.pass_cut(baseStrMllZVetoCut + postFix);
+      
+      if(summary.isOS)
+        manager.pass_cut(baseStrDiLeptonIsOS + postFix);
+    }
+    
+    // For electrons, in principe only veto using VetoID.
+    // But since the user can access any cut he wants, he can take the IDVV_IsoWhatever cut.
+    if(summary.nDiLeptons >= 2) { 
+      manager.pass_cut(baseStrExtraDiLeptonVeto + postFix);
     }
+
   }
 
 }
 
+// ***** ***** *****
+// Dilepton El-El category
+// ***** ***** *****
+bool ElElCategory::event_in_category_pre_analyzers(const ProducersManager& producers) const {
+  const ElectronsProducer& electrons = producers.get<ElectronsProducer>("electrons");
+  return electrons.p4.size() >= 2;
+}
+
+bool ElElCategory::event_in_category_post_analyzers(const ProducersManager& producers, const AnalyzersManager& analyzers) const {
+  return diLeptonFlavourInCategory(analyzers, DiLepFlavour::ElEl);
+}
+
+void ElElCategory::register_cuts(CutManager& manager) {
+  registerDiLeptonCuts(manager);
+}
+
+void ElElCategory::evaluate_cuts_post_analyzers(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers) const {
+  evaluateDiLeptonCuts(manager, producers, analyzers, DiLepFlavour::ElEl, m_MllCutSF, HLT::DoubleEG);
+}
+
 // ***** ***** *****
 // Dilepton El-Mu category
 // ***** ***** *****
@@ -127,102 +110,15 @@ bool ElMuCategory::event_in_category_pre_analyzers(const ProducersManager& produ
 }
 
 bool ElMuCategory::event_in_category_post_analyzers(const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-
-  // It at least one DiLepton of highest Pt and of type ElMu among all ID pairs is found, keep event in this category
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            if( tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ].isElMu )
-              return true;
-          }
-        
-        }
-      }
-    }
-  }
-
-  return false;
+  return diLeptonFlavourInCategory(analyzers, DiLepFlavour::ElMu);
 }
 
 void ElMuCategory::register_cuts(CutManager& manager) {
-  
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          
-          manager.new_cut(baseStrCategory + postFix, baseStrCategory + postFix);
-          manager.new_cut(baseStrExtraDiLeptonVeto + postFix, baseStrExtraDiLeptonVeto + postFix);
-          manager.new_cut(baseStrDiLeptonTriggerMatch + postFix, baseStrDiLeptonTriggerMatch + postFix);
-          manager.new_cut(baseStrMllCut + postFix, baseStrMllCut + postFix);
-          manager.new_cut(baseStrMllZVetoCut + postFix, baseStrMllZVetoCut + postFix);
-          manager.new_cut(baseStrDiLeptonIsOS + postFix, baseStrDiLeptonIsOS + postFix);
-
-        }
-      }
-    }
-  }
-
+  registerDiLeptonCuts(manager);
 }
 
 void ElMuCategory::evaluate_cuts_post_analyzers(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-  const HLTProducer& hlt = producers.get<HLTProducer>("hlt");
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-    
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            const DiLepton& m_diLepton = tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ];
-            
-            if(m_diLepton.isElMu) {
-              manager.pass_cut(baseStrCategory + postFix);
-
-              if(m_diLepton.hlt_idxs.first >= 0 && m_diLepton.hlt_idxs.second >= 0){
-                // We have fired a trigger. Now, check that it is actually a MuonEG trigger
-                if( checkHLT(hlt, m_diLepton.hlt_idxs.first, m_diLepton.hlt_idxs.second, HLT::MuonEG) )
-                  manager.pass_cut(baseStrDiLeptonTriggerMatch + postFix);
-              }
-              
-              if(m_diLepton.p4.M() > m_MllCutDF)
-                manager.pass_cut(baseStrMllCut + postFix);
-              
-              if(m_diLepton.p4.M() < m_MllZVetoCutLow || m_diLepton.p4.M() > m_MllZVetoCutHigh)
-                manager.pass_cut(baseStrMllZVetoCut + postFix);
-              
-              if(m_diLepton.isOS)
-                manager.pass_cut(baseStrDiLeptonIsOS + postFix);
-            }
-          }
-          
-          // For electrons, in principe only veto using VetoID.
-          // But since the user can access any cut he wants, he can take the IDVV_IsoWhatever cut.
-          if(tt.diLeptons_IDIso[comb].size() >= 2) { 
-            manager.pass_cut(baseStrExtraDiLeptonVeto + postFix);
-          }
-
-        }
-      }
-    }
-  }
-
+  evaluateDiLeptonCuts(manager, producers, analyzers, DiLepFlavour::ElMu, m_MllCutDF, HLT::MuonEG);
 }
 
 // ***** ***** *****
@@ -235,102 +131,15 @@ bool MuElCategory::event_in_category_pre_analyzers(const ProducersManager& produ
 }
 
 bool MuElCategory::event_in_category_post_analyzers(const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-
-  // It at least one DiLepton of highest Pt and of type MuEl among all ID pairs is found, keep event in this category
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            if( tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ].isMuEl )
-              return true;
-          }
-        
-        }
-      }
-    }
-  }
-
-  return false;
+  return diLeptonFlavourInCategory(analyzers, DiLepFlavour::MuEl);
 }
 
 void MuElCategory::register_cuts(CutManager& manager) {
-  
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          
-          manager.new_cut(baseStrCategory + postFix, baseStrCategory + postFix);
-          manager.new_cut(baseStrExtraDiLeptonVeto + postFix, baseStrExtraDiLeptonVeto + postFix);
-          manager.new_cut(baseStrDiLeptonTriggerMatch + postFix, baseStrDiLeptonTriggerMatch + postFix);
-          manager.new_cut(baseStrMllCut + postFix, baseStrMllCut + postFix);
-          manager.new_cut(baseStrMllZVetoCut + postFix, baseStrMllZVetoCut + postFix);
-          manager.new_cut(baseStrDiLeptonIsOS + postFix, baseStrDiLeptonIsOS + postFix);
-
-        }
-      }
-    }
-  }
-
+  registerDiLeptonCuts(manager);
 }
 
 void MuElCategory::evaluate_cuts_post_analyzers(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-  const HLTProducer& hlt = producers.get<HLTProducer>("hlt");
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-    
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            const DiLepton& m_diLepton = tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ];
-            
-            if(m_diLepton.isMuEl) {
-              manager.pass_cut(baseStrCategory + postFix);
-
-              if(m_diLepton.hlt_idxs.first >= 0 && m_diLepton.hlt_idxs.second >= 0){
-                // We have fired a trigger. Now, check that it is actually a MuonEG trigger
-                if( checkHLT(hlt, m_diLepton.hlt_idxs.first, m_diLepton.hlt_idxs.second, HLT::MuonEG) )
-                  manager.pass_cut(baseStrDiLeptonTriggerMatch + postFix);
-              }
-              
-              if(m_diLepton.p4.M() > m_MllCutDF)
-                manager.pass_cut(baseStrMllCut + postFix);
-              
-              if(m_diLepton.p4.M() < m_MllZVetoCutLow || m_diLepton.p4.M() > m_MllZVetoCutHigh)
-                manager.pass_cut(baseStrMllZVetoCut + postFix);
-              
-              if(m_diLepton.isOS)
-                manager.pass_cut(baseStrDiLeptonIsOS + postFix);
-            }
-          }
-          
-          // For electrons, in principe only veto using VetoID.
-          // But since the user can access any cut he wants, he can take the IDVV_IsoWhatever cut.
-          if(tt.diLeptons_IDIso[comb].size() >= 2) { 
-            manager.pass_cut(baseStrExtraDiLeptonVeto + postFix);
-          }
-
-        }
-      }
-    }
-  }
-
+  evaluateDiLeptonCuts(manager, producers, analyzers, DiLepFlavour::MuEl, m_MllCutDF, HLT::MuonEG);
 }
 
 // ***** ***** *****
@@ -342,99 +151,13 @@ bool MuMuCategory::event_in_category_pre_analyzers(const ProducersManager& produ
 }
 
 bool MuMuCategory::event_in_category_post_analyzers(const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-
-  // It at least one DiLepton of highest Pt and of type MuMu among all ID pairs is found, keep event in this category
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            if( tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ].isMuMu )
-              return true;
-          }
-        
-        }
-      }
-    }
-  }
-
-  return false;
+  return diLeptonFlavourInCategory(analyzers, DiLepFlavour::MuMu);
 }
 
 void MuMuCategory::register_cuts(CutManager& manager) {
-  
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          
-          manager.new_cut(baseStrCategory + postFix, baseStrCategory + postFix);
-          manager.new_cut(baseStrExtraDiLeptonVeto + postFix, baseStrExtraDiLeptonVeto + postFix);
-          manager.new_cut(baseStrDiLeptonTriggerMatch + postFix, baseStrDiLeptonTriggerMatch + postFix);
-          manager.new_cut(baseStrMllCut + postFix, baseStrMllCut + postFix);
-          manager.new_cut(baseStrMllZVetoCut + postFix, baseStrMllZVetoCut + postFix);
-          manager.new_cut(baseStrDiLeptonIsOS + postFix, baseStrDiLeptonIsOS + postFix);
-
-        }
-      }
-    }
-  }
-
+  registerDiLeptonCuts(manager);
 }
 
 void MuMuCategory::evaluate_cuts_post_analyzers(CutManager& manager, const ProducersManager& producers, const AnalyzersManager& analyzers) const {
-  
-  const TTAnalyzer& tt = analyzers.get<TTAnalyzer>("tt");
-  const HLTProducer& hlt = producers.get<HLTProducer>("hlt");
-
-  for(const LepID::LepID& id1: LepID::it) {
-    for(const LepID::LepID& id2: LepID::it) {
-      for(const LepIso::LepIso& iso1: LepIso::it) {
-        for(const LepIso::LepIso& iso2: LepIso::it) {
-          
-          std::string postFix("_");
-          postFix += LepLepIDIsoStr(id1, iso1, id2, iso2);
-          uint16_t comb = LepLepIDIso(id1, iso1, id2, iso2);
-    
-          if(tt.diLeptons_IDIso[comb].size() >= 1) {
-            const DiLepton& m_diLepton = tt.diLeptons[ tt.diLeptons_IDIso[comb][0] ];
-            
-            if(m_diLepton.isMuMu) {
-              manager.pass_cut(baseStrCategory + postFix);
-
-              if(m_diLepton.hlt_idxs.first >= 0 && m_diLepton.hlt_idxs.second >= 0){
-                // We have fired a trigger. Now, check that it is actually a DoubleMuon trigger
-                if( checkHLT(hlt, m_diLepton.hlt_idxs.first, m_diLepton.hlt_idxs.second, HLT::DoubleMuon) )
-                  manager.pass_cut(baseStrDiLeptonTriggerMatch + postFix);
-              }
-              
-              if(m_diLepton.p4.M() > m_MllCutSF)
-                manager.pass_cut(baseStrMllCut + postFix);
-              
-              if(m_diLepton.p4.M() < m_MllZVetoCutLow || m_diLepton.p4.M() > m_MllZVetoCutHigh)
-                manager.pass_cut(baseStrMllZVetoCut + postFix);
-              
-              if(m_diLepton.isOS)
-                manager.pass_cut(baseStrDiLeptonIsOS + postFix);
-            }
-          }
-          
-          if(tt.diLeptons_IDIso[comb].size() >= 2) { 
-            manager.pass_cut(baseStrExtraDiLeptonVeto + postFix);
-          }
-
-        }
-      }
-    }
-  }
-
+  evaluateDiLeptonCuts(manager, producers, analyzers, DiLepFlavour::MuMu, m_MllCutSF, HLT::DoubleMuon);
 }
-
@@ -0,0 +1,1696 @@
+#include <cp3_llbb/TTAnalysis/interface/Defines.h>
+#include <cp3_llbb/TTAnalysis/interface/Types.h>
+#include <cp3_llbb/TTAnalysis/interface/Tools.h>
+#include <cp3_llbb/TTAnalysis/interface/GenStatusFlags.h>
+#include <cp3_llbb/TTAnalysis/interface/AnalysisCore.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include <Math/PtEtaPhiE4D.h>
+#include <Math/LorentzVector.h>
+#include <Math/VectorUtil.h>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <tuple>
+
+// To access VectorUtil::DeltaR() more easily
+using namespace ROOT::Math;
+
+using namespace TTAnalysis;
+
+float TTAnalysis::DeltaEta(const myLorentzVector& v1, const myLorentzVector& v2) {
+  return std::abs(v1.Eta() - v2.Eta());
+}
+
+AnalysisCore::AnalysisCore(const AnalysisConfig& config):
+  m_config(config),
+  m_data_neutrinos_solver(173.34, 80.385, config.neutrinosSolverPrecheck),
+  m_mc_neutrinos_solver(172.5, 80.419002, config.neutrinosSolverPrecheck) {
+
+  m_preselection_counters.fill(0);
+  m_degradation_counters.fill(0);
+
+  m_compute.ttbarCompact = isBranchEnabled("ttbar_compact");
+  m_compute.ttbarRejected = config.neutrinosSolverPrecheck && isBranchEnabled("ttbar_rejected");
+  m_compute.ttbarSmeared = config.ttbarSmearingSamples && isBranchEnabled("ttbar_smeared");
+  m_compute.ttbar = isBranchEnabled("ttbar") || m_compute.ttbarCompact || m_compute.ttbarRejected || m_compute.ttbarSmeared;
+
+  if(m_compute.ttbarSmeared){
+    TTBarSmearing::Settings smearing;
+    smearing.samples = config.ttbarSmearingSamples;
+    smearing.leptonResolution = config.ttbarSmearingLeptonResolution;
+    smearing.jetResolution = config.ttbarSmearingJetResolution;
+    smearing.metResolution = config.ttbarSmearingMetResolution;
+    m_ttbar_smearing.reset(new TTBarSmearing(smearing));
+  }
+  m_compute.diLepDiJetsMetLists = isBranchEnabled("diLepDiJetsMet_DRCut") || isBranchEnabled("diLepDiBJetsMet_DRCut_BWP_PtOrdered") || isBranchEnabled("diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered") || m_compute.ttbar;
+  m_compute.diLepDiJetsMet = isBranchEnabled("diLepDiJetsMet") || m_compute.diLepDiJetsMetLists;
+  m_compute.diLepDiJetsMetAngles = isBranchEnabled("diLepDiJetsMet");
+  m_compute.diLepDiJetsLists = isBranchEnabled("diLepDiJets_DRCut") || isBranchEnabled("diLepDiBJets_DRCut_BWP_PtOrdered") || isBranchEnabled("diLepDiBJets_DRCut_BWP_CSVv2Ordered");
+  m_compute.diLepDiJets = isBranchEnabled("diLepDiJets") || m_compute.diLepDiJetsLists || m_compute.diLepDiJetsMet;
+  m_compute.diLepDiJetsAngles = isBranchEnabled("diLepDiJets") || isBranchEnabled("diLepDiJetsMet");
+
+  if(config.stageThreads)
+    m_pool.reset(new TaskPool(config.stageThreads));
+  buildStages();
+}
+
+/*
+ * Stages of an event and the data they need (see TaskGraph). Each stage only writes its own outputs, and only reads the ones of its dependencies,
+ * so that running them concurrently gives the same outputs as running them sequentially. The stages running after the lepton selection
+ * only modify disjoint members of the leptons (trigger matching: hlt_*, quantization: angular variables of the dileptons).
+ */
+void AnalysisCore::buildStages() {
+
+  typedef TaskGraph::Stage Stage;
+
+  // Only needs the gen particles: runs concurrently with the whole lepton selection
+  const Stage genTruth = m_event_stages.add([this] {
+      if(!m_isRealData)
+        fillGenInfo(m_event_inputs->genParticles);
+  });
+  const Stage selectedLeptons = m_event_stages.add([this] { selectLeptons(m_event_inputs->electrons, m_event_inputs->muons); });
+  const Stage trigger = m_event_stages.add([this] { matchTrigger(m_event_inputs->hlt); }, {selectedLeptons});
+  m_event_stages.add([this] { fillDiLeptonsSummary(); }, {trigger});
+  m_event_stages.add([this] {
+      if(m_matchGenLeptons)
+        matchGenLeptons();
+  }, {selectedLeptons, genTruth});
+  m_event_stages.add([this] { quantizeLeptonAngularVariables(); }, {selectedLeptons});
+
+  // The jets of each variation: the ttbar reconstruction (MTT) and the gen matching of the jets only share the selected jets
+  const Stage selectedJets = m_jet_stages.add([this] { preselectJets(*m_jets_inputs); });
+  const Stage combinatorics = m_jet_stages.add([this] {
+      if(m_passedJets)
+        buildJetCombinatorics(*m_jets_inputs, m_met_p4);
+  }, {selectedJets});
+  const Stage ttbarReconstruction = m_jet_stages.add([this] {
+      if(m_reconstructTTBar)
+        reconstructTTBar(m_met_p4, m_isRealData ? m_data_neutrinos_solver : m_mc_neutrinos_solver);
+  }, {combinatorics});
+  const Stage genJets = m_jet_stages.add([this] {
+      if(m_passedLeptons && m_matchGenJets)
+        matchGenJets();
+  }, {selectedJets});
+  m_jet_stages.add([this] {
+      if(m_passedLeptons)
+        quantizeJetAngularVariables();
+  }, {ttbarReconstruction, genJets});
+}
+
+void AnalysisCore::analyze(const EventInputs& inputs) {
+  
+  #ifdef _TT_DEBUG_
+    std::cout << "Begin event." << std::endl;
+  #endif
+
+  clear();
+
+  // Initizalize vectors depending on IDs/WPs to the right lengths
+  // Only a resize() is needed (and no assign()), since the vectors have just been cleared.
+
+  electrons_IDIso.resize( LepID::Count * LepIso::Count );
+  muons_IDIso.resize( LepID::Count * LepIso::Count );
+  leptons_IDIso.resize( LepID::Count * LepIso::Count );
+
+  diLeptons_IDIso.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count );
+
+  m_isRealData = inputs.isRealData;
+  m_event_seed = RandomStream::seed({m_config.ttbarSmearingSeed, inputs.run, inputs.lumi, inputs.event});
+  m_matchGenLeptons = false;
+  m_matchGenJets = false;
+
+  // Lepton selection, trigger matching, summary for the categories and gen-level information (see buildStages()).
+  // They don't depend on the jets, and run even for the events rejected by the preselection.
+  m_event_inputs = &inputs;
+  m_event_stages.run(m_pool.get());
+
+  analyzeJets(inputs.jets, inputs.met_p4);
+  m_preselection_counters[preselection]++;
+  for(const Degradation::Stage& stage: Degradation::it){
+    if(degraded & (1 << stage))
+      m_degradation_counters[stage]++;
+  }
+  m_telemetry_summary.add(telemetry);
+
+  #ifdef _TT_DEBUG_
+    std::cout << "End event." << std::endl;
+  #endif
+
+}
+
+void AnalysisCore::selectLeptons(const ElectronsInputs& electrons, const MuonsInputs& muons) {
+
+  ///////////////////////////
+  //       ELECTRONS       //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Electrons" << std::endl;
+  #endif
+
+  for(uint16_t ielectron = 0; ielectron < electrons.p4.size(); ielectron++){
+    if( electrons.p4[ielectron].Pt() > m_config.electronPtCut && std::abs(electrons.p4[ielectron].Eta()) < m_config.electronEtaCut ){
+      
+      Lepton m_lepton(
+          electrons.p4[ielectron], 
+          ielectron, 
+          electrons.charge[ielectron], 
+          true, false,
+          electrons.vetoID[ielectron],
+          electrons.looseID[ielectron],
+          electrons.mediumID[ielectron],
+          electrons.tightID[ielectron],
+          electrons.relativeIsoR03_withEA[ielectron]
+      );
+      
+      for(const LepID::LepID& id: LepID::it){
+        for(const LepIso::LepIso& iso: LepIso::it){ // loop over Iso not really needed since not considered for electrons (for the moment)
+          uint16_t idx = LepIDIso(id, iso);
+          if( m_lepton.ID[id] && m_lepton.iso[iso] )
+            electrons_IDIso[idx].push_back(ielectron);
+        }
+      }
+      
+      leptons.push_back(m_lepton);
+    }
+  }
+
+  ///////////////////////////
+  //       MUONS           //
+  ///////////////////////////
+  
+  #ifdef _TT_DEBUG_
+    std::cout << "Muons" << std::endl;
+  #endif
+
+  for(uint16_t imuon = 0; imuon < muons.p4.size(); imuon++){
+    if(muons.p4[imuon].Pt() > m_config.muonPtCut && std::abs(muons.p4[imuon].Eta()) < m_config.muonEtaCut ){
+      
+      Lepton m_lepton(
+          muons.p4[imuon], 
+          imuon,
+          muons.charge[imuon], 
+          false, true,
+          muons.isLoose[imuon], // isVeto => for muons, re-use isLoose
+          muons.isLoose[imuon],
+          muons.isMedium[imuon],
+          muons.isTight[imuon],
+          muons.relativeIsoR04_deltaBeta[imuon],
+          muons.relativeIsoR04_deltaBeta[imuon] < m_config.muonLooseIsoCut,
+          muons.relativeIsoR04_deltaBeta[imuon] < m_config.muonTightIsoCut
+      );
+
+      for(const LepID::LepID& id: LepID::it){
+        for(const LepIso::LepIso& iso: LepIso::it){
+          uint16_t idx = LepIDIso(id, iso);
+          if( m_lepton.ID[id] && m_lepton.iso[iso] )
+            muons_IDIso[idx].push_back(imuon);
+        }
+      }
+
+      leptons.push_back(m_lepton);
+    }
+  }
+
+  // Sort the leptons vector according to Pt
+  std::sort(leptons.begin(), leptons.end(), [](const Lepton& a, const Lepton &b){ return a.p4.Pt() > b.p4.Pt(); });
+
+  m_leptons_cartesian.clear();
+  for(const Lepton& m_lepton: leptons)
+    m_leptons_cartesian.push_back(myCartesianVector(m_lepton.p4));
+
+  // Store indices to leptons for each ID/Iso combination
+  for(uint16_t idx = 0; idx < leptons.size(); idx++){
+    for(const LepID::LepID& id: LepID::it){
+      for(const LepIso::LepIso& iso: LepIso::it){
+         
+        uint16_t comb = LepIDIso(id, iso);
+        const Lepton& m_lepton = leptons[idx];
+        if(m_lepton.ID[id] && m_lepton.iso[iso])
+          leptons_IDIso[comb].push_back(idx);
+
+      }
+    }
+  }
+
+  m_passedLeptons = leptons.size() >= m_config.preselectionMinLeptons;
+  if(m_passedLeptons)
+    buildDiLeptons();
+}
+
+void AnalysisCore::analyzeJetVariation(const JetsInputs& jets, const myLorentzVector& met_p4) {
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Jet variation." << std::endl;
+  #endif
+
+  clearJetOutputs();
+  analyzeJets(jets, met_p4);
+}
+
+// Everything depending on the jets and the MET, for the leptons and gen-level information of the current event
+void AnalysisCore::analyzeJets(const JetsInputs& jets, const myLorentzVector& met_p4) {
+
+  m_passedJets = false;
+  m_reconstructTTBar = false;
+
+  // Jet selection, combinatorics, ttbar reconstruction and gen-level matching of the jets (see buildStages())
+  m_jets_inputs = &jets;
+  m_met_p4 = met_p4;
+  m_jet_stages.run(m_pool.get());
+}
+
+// Jet selection, and the preselection of the event
+void AnalysisCore::preselectJets(const JetsInputs& jets) {
+
+  // Initizalize vectors depending on IDs/WPs to the right lengths
+  // Only a resize() is needed (and no assign()), since the vectors have just been cleared.
+
+  selJets_selID_DRCut.resize( LepID::Count * LepIso::Count );
+  selBJets_DRCut_BWP_PtOrdered.resize( LepID::Count * LepIso::Count * BWP::Count );
+  selBJets_DRCut_BWP_CSVv2Ordered.resize( LepID::Count * LepIso::Count * BWP::Count );
+
+  diJets_DRCut.resize( LepID::Count * LepIso::Count );
+  diBJets_DRCut_BWP_PtOrdered.resize( LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  diBJets_DRCut_BWP_CSVv2Ordered.resize( LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  
+  diLepDiJets_DRCut.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count );
+  diLepDiBJets_DRCut_BWP_PtOrdered.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  diLepDiBJets_DRCut_BWP_CSVv2Ordered.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  
+  diLepDiJetsMet_DRCut.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count );
+  diLepDiBJetsMet_DRCut_BWP_PtOrdered.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  
+  ttbar.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  ttbar_compact.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  ttbar_rejected.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+  ttbar_smeared.resize( LepID::Count * LepIso::Count * LepID::Count * LepIso::Count * BWP::Count * BWP::Count );
+
+  gen_matched_b.resize( LepID::Count * LepIso::Count , -1);
+  gen_matched_b_beforeFSR.resize( LepID::Count * LepIso::Count , -1);
+  gen_matched_bbar.resize( LepID::Count * LepIso::Count , -1);
+  gen_matched_bbar_beforeFSR.resize( LepID::Count * LepIso::Count , -1);
+  gen_b_deltaR.resize( LepID::Count * LepIso::Count );
+  gen_b_beforeFSR_deltaR.resize( LepID::Count * LepIso::Count );
+  gen_bbar_deltaR.resize( LepID::Count * LepIso::Count );
+  gen_bbar_beforeFSR_deltaR.resize( LepID::Count * LepIso::Count );
+
+  telemetry.leptons = leptons.size();
+  telemetry.diLeptons = diLeptons.size();
+
+  if(!m_passedLeptons){
+    #ifdef _TT_DEBUG_
+      std::cout << "Event rejected by the preselection (" << Preselection::map.at(Preselection::Leptons) << ")" << std::endl;
+    #endif
+
+    preselection = Preselection::Leptons;
+    return;
+  }
+
+  selectJets(jets);
+  telemetry.selJets = selJets.size();
+
+  if(selJets_selID.size() < m_config.preselectionMinJets){
+    // Stop the event right after the jet selection: none of the combinatorics is built
+    #ifdef _TT_DEBUG_
+      std::cout << "Event rejected by the preselection (" << Preselection::map.at(Preselection::Jets) << ")" << std::endl;
+    #endif
+
+    preselection = Preselection::Jets;
+    return;
+  }
+
+  m_passedJets = true;
+}
+
+// Lepton-jet combinatorics of the events passing the preselection
+void AnalysisCore::buildJetCombinatorics(const JetsInputs& jets, const myLorentzVector& met_p4) {
+
+  buildDiJets(jets);
+  telemetry.diJets = diJets.size();
+
+  // Only build the combinatorics needed by the enabled branches, and within the caps:
+  // a pathological event is flagged in `degraded` instead of growing without bound
+
+  const size_t nDiLepDiJets = diLeptons.size() * diJets.size();
+
+  if(m_config.maxDiLepDiJets && nDiLepDiJets > m_config.maxDiLepDiJets){
+    degraded |= 1 << Degradation::DiLepDiJets;
+  } else {
+    if(m_compute.diLepDiJets){
+      buildDiLepDiJets(jets);
+      telemetry.diLepDiJets = diLepDiJets.size();
+    }
+
+    if(m_compute.diLepDiJetsMet)
+      buildDiLepDiJetsMet(jets, met_p4);
+
+    if(m_compute.ttbar){
+      if(m_config.ttbarMaxDiLepDiJets && nDiLepDiJets > m_config.ttbarMaxDiLepDiJets)
+        degraded |= 1 << Degradation::TTBar;
+      else
+        m_reconstructTTBar = true;
+    }
+  }
+
+  preselection = Preselection::Passed;
+}
+
+void AnalysisCore::buildDiLeptons() {
+
+  ///////////////////////////
+  //       DILEPTONS       //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Dileptons" << std::endl;
+  #endif
+
+  m_diLeptons_cartesian.clear();
+
+  for(uint16_t i1 = 0; i1 < leptons.size(); i1++){
+    for(uint16_t i2 = i1 + 1; i2 < leptons.size(); i2++){
+      const Lepton& l1 = leptons[i1];
+      const Lepton& l2 = leptons[i2];
+
+      DiLepton m_diLepton;
+
+      const myCartesianVector cartesian_p4 = m_leptons_cartesian[i1] + m_leptons_cartesian[i2];
+      m_diLepton.p4 = myLorentzVector(cartesian_p4);
+      m_diLepton.idxs = IndexPair<uint16_t>(l1.idx, l2.idx); 
+      m_diLepton.lidxs = IndexPair<uint16_t>(i1, i2); 
+      m_diLepton.isElEl = l1.isEl && l2.isEl;
+      m_diLepton.isElMu = l1.isEl && l2.isMu;
+      m_diLepton.isMuEl = l1.isMu && l2.isEl;
+      m_diLepton.isMuMu = l1.isMu && l2.isMu;
+      m_diLepton.isOS = l1.charge != l2.charge;
+      m_diLepton.isSF = m_diLepton.isElEl || m_diLepton.isMuMu;
+ 
+      // Save the combination of IDs
+      for(const LepID::LepID& id1: LepID::it){
+        for(const LepID::LepID& id2: LepID::it){
+          uint16_t idx = LepLepID(id1, id2);
+          m_diLepton.ID[idx] = l1.ID[id1] && l2.ID[id2];
+        }
+      }
+
+      // Save the combination of isolations
+      for(const LepIso::LepIso& iso1: LepIso::it){
+        for(const LepIso::LepIso& iso2: LepIso::it){
+          uint16_t idx = LepLepIso(iso1, iso2);
+          m_diLepton.iso[idx] = l1.iso[iso1] && l2.iso[iso2];
+        }
+      }
+      
+      m_diLepton.DR = VectorUtil::DeltaR(l1.p4, l2.p4);
+      m_diLepton.DEta = TTAnalysis::DeltaEta(l1.p4, l2.p4);
+      m_diLepton.DPhi = VectorUtil::DeltaPhi(l1.p4, l2.p4);
+
+      diLeptons.push_back(m_diLepton);
+      m_diLeptons_cartesian.push_back(cartesian_p4);
+    }
+  }
+
+  // Save indices to DiLeptons for the combinations of IDs & Isolationss
+  for(uint16_t i = 0; i < diLeptons.size(); i++){
+    const DiLepton& m_diLepton = diLeptons[i];
+    
+    for(const LepID::LepID& id1: LepID::it){
+      for(const LepID::LepID& id2: LepID::it){
+        for(const LepIso::LepIso& iso1: LepIso::it){
+          for(const LepIso::LepIso& iso2: LepIso::it){
+            
+            uint16_t idx_ids = LepLepID(id1, id2);
+            uint16_t idx_isos = LepLepIso(iso1, iso2);
+            uint16_t idx_comb = LepLepIDIso(id1, iso1, id2, iso2);
+
+            if(m_diLepton.ID[idx_ids] && m_diLepton.iso[idx_isos])
+              diLeptons_IDIso[idx_comb].push_back(i);
+          
+          }
+        }
+      }
+    }
+    
+  }
+}
+
+void AnalysisCore::selectJets(const JetsInputs& jets) {
+
+  ///////////////////////////
+  //       JETS            //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Jets" << std::endl;
+  #endif
+
+  // If the Pt-ordered b-jets are not stored, directly fill (and then sort) the CSVv2-ordered ones
+  std::vector<std::vector<uint16_t>>& selBJets_DRCut_BWP = isBranchEnabled("selBJets_DRCut_BWP_PtOrdered") ? selBJets_DRCut_BWP_PtOrdered : selBJets_DRCut_BWP_CSVv2Ordered;
+
+  // First find the jets passing kinematic cuts and save them as Jet objects
+
+  m_selJets_cartesian.clear();
+
+  uint16_t jetCounter(0);
+  for(uint16_t ijet = 0; ijet < jets.p4.size(); ijet++){
+    // Save the jets that pass the kinematic cuts
+    if (std::abs(jets.p4[ijet].Eta()) < m_config.jetEtaCut && jets.p4[ijet].Pt() > m_config.jetPtCut){
+      Jet m_jet;
+      
+      m_jet.p4 = jets.p4[ijet];
+      m_jet.idx = ijet;
+      m_jet.ID[JetID::L] = jets.passLooseID[ijet]; 
+      m_jet.ID[JetID::T] = jets.passTightID[ijet]; 
+      m_jet.ID[JetID::TLV] = jets.passTightLeptonVetoID[ijet];
+      m_jet.CSVv2 = jets.CSVv2[ijet];
+      m_jet.BWP[BWP::L] = m_jet.CSVv2 > m_config.jetCSVv2L;
+      m_jet.BWP[BWP::M] = m_jet.CSVv2 > m_config.jetCSVv2M;
+      m_jet.BWP[BWP::T] = m_jet.CSVv2 > m_config.jetCSVv2T;
+      
+      // Save minimal DR(l,j) using selected leptons, for each Lepton ID/Iso
+      for(const LepID::LepID& id: LepID::it){
+        for(const LepIso::LepIso& iso: LepIso::it){
+              
+          uint16_t idx_comb = LepIDIso(id, iso);
+          
+          for(const uint16_t& lepIdx: leptons_IDIso[idx_comb]){
+            const Lepton& m_lepton = leptons[lepIdx];
+            float DR = (float) VectorUtil::DeltaR(jets.p4[ijet], m_lepton.p4);
+            if( DR < m_jet.minDRjl_lepIDIso[idx_comb] )
+              m_jet.minDRjl_lepIDIso[idx_comb] = DR;
+          }
+          
+          // Save the indices to Jets passing the selected jetID and minDRjl > cut for this lepton ID/Iso
+          if( m_jet.minDRjl_lepIDIso[idx_comb] > m_config.jetDRleptonCut && passJetID(jets, ijet) ){
+            selJets_selID_DRCut[idx_comb].push_back(jetCounter);
+
+            // Out of these, save the indices for different b-tagging working points
+            for(const BWP::BWP& wp: BWP::it){
+              uint16_t idx_comb_b = LepIDIsoJetBWP(id, iso, wp);
+              if ((m_jet.BWP[wp]) && (std::abs(m_jet.p4.Eta()) < m_config.bJetEtaCut))
+                selBJets_DRCut_BWP[idx_comb_b].push_back(jetCounter);
+            }
+          }
+        }
+      }
+      
+      if(passJetID(jets, ijet)) // Save the indices to Jets passing the selected jet ID
+        selJets_selID.push_back(jetCounter);
+      
+      selJets.push_back(m_jet);
+      m_selJets_cartesian.push_back(myCartesianVector(m_jet.p4));
+      
+      jetCounter++;
+    }
+  }
+
+  // Sort the b-jets according to decreasing CSVv2 value
+  if(&selBJets_DRCut_BWP != &selBJets_DRCut_BWP_CSVv2Ordered)
+    selBJets_DRCut_BWP_CSVv2Ordered = selBJets_DRCut_BWP;
+  for(const LepID::LepID& id: LepID::it){
+    for(const LepIso::LepIso& iso: LepIso::it){
+      for(const BWP::BWP& wp: BWP::it){ 
+        uint16_t idx_comb_b = LepIDIsoJetBWP(id, iso, wp);
+        std::sort(selBJets_DRCut_BWP_CSVv2Ordered[idx_comb_b].begin(), selBJets_DRCut_BWP_CSVv2Ordered[idx_comb_b].end(), jetBTagDiscriminantSorter(jets.CSVv2, selJets));
+      }
+    }
+  }
+}
+
+void AnalysisCore::buildDiJets(const JetsInputs& jets) {
+
+  ///////////////////////////
+  //       DIJETS          //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Dijets" << std::endl;
+  #endif
+
+  // Next, construct DiJets out of selected jets with selected ID (not accounting for minDRjl here)
+
+  m_diJets_cartesian.clear();
+
+  uint16_t diJetCounter(0);
+
+  const bool fill_diJets_DRCut = isBranchEnabled("diJets_DRCut");
+  std::vector<std::vector<uint16_t>>& diBJets_DRCut_BWP = isBranchEnabled("diBJets_DRCut_BWP_PtOrdered") ? diBJets_DRCut_BWP_PtOrdered : diBJets_DRCut_BWP_CSVv2Ordered;
+
+  for(uint16_t j1 = 0; j1 < selJets_selID.size(); j1++){
+    for(uint16_t j2 = j1 + 1; j2 < selJets_selID.size(); j2++){
+      const uint16_t jidx1 = selJets_selID[j1];
+      const Jet& jet1 = selJets[jidx1];
+      const uint16_t jidx2 = selJets_selID[j2];
+      const Jet& jet2 = selJets[jidx2];
+
+      DiJet m_diJet; 
+      const myCartesianVector cartesian_p4 = m_selJets_cartesian[jidx1] + m_selJets_cartesian[jidx2];
+      m_diJet.p4 = myLorentzVector(cartesian_p4);
+      m_diJet.idxs = IndexPair<uint16_t>(jet1.idx, jet2.idx);
+      m_diJet.jidxs = IndexPair<uint16_t>(jidx1, jidx2);
+      
+      m_diJet.DR = VectorUtil::DeltaR(jet1.p4, jet2.p4);
+      m_diJet.DEta = DeltaEta(jet1.p4, jet2.p4);
+      m_diJet.DPhi = VectorUtil::DeltaPhi(jet1.p4, jet2.p4);
+     
+      for(const BWP::BWP& wp1: BWP::it){
+        for(const BWP::BWP& wp2: BWP::it){
+          uint16_t comb = JetJetBWP(wp1, wp2);
+          m_diJet.BWP[comb] = jet1.BWP[wp1] && jet2.BWP[wp2];
+        }
+      }
+      
+      for(const LepID::LepID& id: LepID::it){
+        for(const LepIso::LepIso& iso: LepIso::it){
+          uint16_t combIDIso = LepIDIso(id, iso);
+
+          m_diJet.minDRjl_lepIDIso[combIDIso] = std::min(jet1.minDRjl_lepIDIso[combIDIso], jet2.minDRjl_lepIDIso[combIDIso]);
+          
+          // Save the DiJets which have minDRjl>cut, for each leptonIDIso
+          if(m_diJet.minDRjl_lepIDIso[combIDIso] > m_config.jetDRleptonCut){
+            if(fill_diJets_DRCut)
+              diJets_DRCut[combIDIso].push_back(diJetCounter);
+
+            // Out of these, save di-b-jets for each combination of b-tagging working points
+            for(const BWP::BWP& wp1: BWP::it){
+              for(const BWP::BWP& wp2: BWP::it){
+                uint16_t combB = JetJetBWP(wp1, wp2);
+                uint16_t combAll = LepIDIsoJetJetBWP(id, iso, wp1, wp2);
+                if ((m_diJet.BWP[combB])
+                        && (std::abs(jet1.p4.Eta()) < m_config.bJetEtaCut)
+                        && (std::abs(jet2.p4.Eta()) < m_config.bJetEtaCut))
+                  diBJets_DRCut_BWP[combAll].push_back(diJetCounter);
+              }
+            }
+          
+          }
+        
+        }
+      }
+      
+      diJets.push_back(m_diJet); 
+      m_diJets_cartesian.push_back(cartesian_p4);
+      diJetCounter++;
+    }
+  }
+
+  // Order selected di-b-jets according to decreasing CSVv2 discriminant, only keeping the first `maxCandidatesPerCombination` of each list
+  if(&diBJets_DRCut_BWP != &diBJets_DRCut_BWP_CSVv2Ordered)
+    diBJets_DRCut_BWP_CSVv2Ordered = diBJets_DRCut_BWP;
+  for(const LepID::LepID& id: LepID::it){
+    for(const LepIso::LepIso& iso: LepIso::it){
+      for(const BWP::BWP& wp1: BWP::it){ 
+        for(const BWP::BWP& wp2: BWP::it){ 
+          uint16_t idx_comb_b = LepIDIsoJetJetBWP(id, iso, wp1, wp2);
+          sortCandidates(diBJets_DRCut_BWP_CSVv2Ordered[idx_comb_b], m_config.maxCandidatesPerCombination, diJetBTagDiscriminantSorter(jets.CSVv2, diJets));
+          keepCandidates(diBJets_DRCut_BWP_PtOrdered[idx_comb_b], m_config.maxCandidatesPerCombination);
+        }
+      }
+    }
+  }
+}
+
+void AnalysisCore::buildDiLepDiJets(const JetsInputs& jets) {
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Dileptons-dijets" << std::endl;
+  #endif
+
+  // leptons-(b-)jets
+
+  m_diLepDiJets_cartesian.clear();
+
+  uint16_t diLepDiJetCounter(0);
+
+  const bool fill_diLepDiJets_DRCut = isBranchEnabled("diLepDiJets_DRCut");
+  std::vector<std::vector<uint16_t>>& diLepDiBJets_DRCut_BWP = isBranchEnabled("diLepDiBJets_DRCut_BWP_PtOrdered") ? diLepDiBJets_DRCut_BWP_PtOrdered : diLepDiBJets_DRCut_BWP_CSVv2Ordered;
+
+  for(uint16_t dilep = 0; dilep < diLeptons.size(); dilep++){
+    const DiLepton& m_diLepton = diLeptons[dilep];
+    
+    for(uint16_t dijet = 0; dijet < diJets.size(); dijet++){
+      const DiJet& m_diJet =  diJets[dijet];
+      
+      const myCartesianVector cartesian_p4 = m_diLeptons_cartesian[dilep] + m_diJets_cartesian[dijet];
+      DiLepDiJet m_diLepDiJet(m_diLepton, dilep, m_diJet, dijet, cartesian_p4);
+
+      // Angular variables between the leptons and the jets: only computed if they are stored
+      if(m_compute.diLepDiJetsAngles){
+        const myLorentzVector* lepton_p4s[2] = { &leptons[m_diLepton.lidxs.first].p4, &leptons[m_diLepton.lidxs.second].p4 };
+        const myLorentzVector* jet_p4s[2] = { &selJets[m_diJet.jidxs.first].p4, &selJets[m_diJet.jidxs.second].p4 };
+
+        std::array<float, 4> DRjl, DEtajl, DPhijl;
+        for(uint16_t l = 0; l < 2; l++){
+          for(uint16_t j = 0; j < 2; j++){
+            DRjl[2*l + j] = VectorUtil::DeltaR(*lepton_p4s[l], *jet_p4s[j]);
+            DEtajl[2*l + j] = DeltaEta(*lepton_p4s[l], *jet_p4s[j]);
+            DPhijl[2*l + j] = VectorUtil::DeltaPhi(*lepton_p4s[l], *jet_p4s[j]);
+          }
+        }
+
+        std::tie(m_diLepDiJet.minDRjl, m_diLepDiJet.maxDRjl) = std::minmax( { DRjl[0], DRjl[1], DRjl[2], DRjl[3] } );
+        std::tie(m_diLepDiJet.minDEtajl, m_diLepDiJet.maxDEtajl) = std::minmax( { DEtajl[0], DEtajl[1], DEtajl[2], DEtajl[3] } );
+        std::tie(m_diLepDiJet.minDPhijl, m_diLepDiJet.maxDPhijl) = std::minmax( { DPhijl[0], DPhijl[1], DPhijl[2], DPhijl[3] } );
+      }
+
+      diLepDiJets.push_back(m_diLepDiJet);
+      m_diLepDiJets_cartesian.push_back(cartesian_p4);
+
+      if(!m_compute.diLepDiJetsLists){
+        diLepDiJetCounter++;
+        continue;
+      }
+
+      for(const LepID::LepID& id1: LepID::it){
+        for(const LepID::LepID& id2: LepID::it){
+          for(const LepIso::LepIso& iso1: LepIso::it){
+            for(const LepIso::LepIso& iso2: LepIso::it){
+              
+              uint16_t combID = LepLepID(id1, id2);
+              LepID::LepID minID = std::min(id1, id2);
+              
+              uint16_t combIso = LepLepIso(iso1, iso2);
+              LepIso::LepIso minIso = std::min(iso1, iso2);
+
+              uint16_t minCombIDIso = LepIDIso(minID, minIso);
+              uint16_t diLepCombIDIso = LepLepIDIso(id1, iso1, id2, iso2);
+             
+              // Store objects for each combined lepton ID/Iso, with jets having minDRjl>cut for leptons corresponding to the loosest combination of the aforementioned ID/Iso
+              if(m_diLepton.ID[combID] && m_diLepton.iso[combIso] && m_diJet.minDRjl_lepIDIso[minCombIDIso] > m_config.jetDRleptonCut){
+                if(fill_diLepDiJets_DRCut)
+                  diLepDiJets_DRCut[diLepCombIDIso].push_back(diLepDiJetCounter);
+                
+                // Out of these, store combinations of b-tagging working points
+                for(const BWP::BWP& wp1: BWP::it){
+                  for(const BWP::BWP& wp2: BWP::it){
+                    uint16_t combB = JetJetBWP(wp1, wp2);
+                    uint16_t combAll = LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2);
+                    if ((m_diJet.BWP[combB])
+                            && (std::abs(jets.p4[m_diJet.idxs.first].Eta()) < m_config.bJetEtaCut)
+                            && (std::abs(jets.p4[m_diJet.idxs.second].Eta()) < m_config.bJetEtaCut))
+                      diLepDiBJets_DRCut_BWP[combAll].push_back(diLepDiJetCounter);
+                  }
+                } // end b-jet loops
+
+              } // end minDRjl>cut
+
+            }
+          } // end lepton iso loops
+        }
+      } // end lepton ID loops
+
+      diLepDiJetCounter++;
+    } // end dijet loop
+  } // end dilepton loop
+
+  // Order selected di-lepton-di-b-jets according to decreasing CSVv2 discriminant, only keeping the first `maxCandidatesPerCombination` of each list
+  if(&diLepDiBJets_DRCut_BWP != &diLepDiBJets_DRCut_BWP_CSVv2Ordered)
+    diLepDiBJets_DRCut_BWP_CSVv2Ordered = diLepDiBJets_DRCut_BWP;
+  
+  for(const LepID::LepID& id1: LepID::it){
+    for(const LepID::LepID& id2: LepID::it){
+      
+      for(const LepIso::LepIso& iso1: LepIso::it){
+        for(const LepIso::LepIso& iso2: LepIso::it){
+          
+          for(const BWP::BWP& wp1: BWP::it){ 
+            for(const BWP::BWP& wp2: BWP::it){ 
+              
+              uint16_t idx_comb_all = LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2);
+              sortCandidates(diLepDiBJets_DRCut_BWP_CSVv2Ordered[idx_comb_all], m_config.maxCandidatesPerCombination, diJetBTagDiscriminantSorter(jets.CSVv2, diLepDiJets));
+              keepCandidates(diLepDiBJets_DRCut_BWP_PtOrdered[idx_comb_all], m_config.maxCandidatesPerCombination);
+            
+            }
+          }
+        
+        }
+      }
+    
+    }
+  }
+}
+
+void AnalysisCore::buildDiLepDiJetsMet(const JetsInputs& jets, const myLorentzVector& met_p4) {
+
+  // leptons-(b-)jets-MET
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Dileptons-Dijets-MET" << std::endl;
+  #endif
+
+  const bool fill_diLepDiJetsMet_DRCut = isBranchEnabled("diLepDiJetsMet_DRCut");
+  std::vector<std::vector<uint16_t>>& diLepDiBJetsMet_DRCut_BWP = isBranchEnabled("diLepDiBJetsMet_DRCut_BWP_PtOrdered") ? diLepDiBJetsMet_DRCut_BWP_PtOrdered : diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered;
+
+  // Converted once to cartesian coordinates for all the candidates
+  const myCartesianVector met_cartesian(met_p4);
+
+  for(uint16_t i = 0; i < diLepDiJets.size(); i++){
+    // Using regular MET
+    DiLepDiJetMet m_diLepDiJetMet(diLepDiJets[i], i, m_diLepDiJets_cartesian[i] + met_cartesian, met_p4);
+    
+    // Angular variables between the leptons/jets and the MET: only computed if they are stored
+    if(m_compute.diLepDiJetsMetAngles){
+      const myLorentzVector* p4s[4] = {
+        &leptons[m_diLepDiJetMet.diLepton->lidxs.first].p4, &leptons[m_diLepDiJetMet.diLepton->lidxs.second].p4,
+        &selJets[m_diLepDiJetMet.diJet->jidxs.first].p4, &selJets[m_diLepDiJetMet.diJet->jidxs.second].p4
+      };
+
+      std::array<float, 4> DR, DEta, DPhi;
+      for(uint16_t k = 0; k < 4; k++){
+        DR[k] = VectorUtil::DeltaR(*p4s[k], met_p4);
+        DEta[k] = DeltaEta(*p4s[k], met_p4);
+        DPhi[k] = VectorUtil::DeltaPhi(*p4s[k], met_p4);
+      }
+
+      std::tie(m_diLepDiJetMet.minDR_l_Met, m_diLepDiJetMet.maxDR_l_Met) = std::minmax(DR[0], DR[1]);
+      std::tie(m_diLepDiJetMet.minDEta_l_Met, m_diLepDiJetMet.maxDEta_l_Met) = std::minmax(DEta[0], DEta[1]);
+      std::tie(m_diLepDiJetMet.minDPhi_l_Met, m_diLepDiJetMet.maxDPhi_l_Met) = std::minmax(DPhi[0], DPhi[1]);
+
+      std::tie(m_diLepDiJetMet.minDR_j_Met, m_diLepDiJetMet.maxDR_j_Met) = std::minmax(DR[2], DR[3]);
+      std::tie(m_diLepDiJetMet.minDEta_j_Met, m_diLepDiJetMet.maxDEta_j_Met) = std::minmax(DEta[2], DEta[3]);
+      std::tie(m_diLepDiJetMet.minDPhi_j_Met, m_diLepDiJetMet.maxDPhi_j_Met) = std::minmax(DPhi[2], DPhi[3]);
+    }
+
+    diLepDiJetsMet.push_back(m_diLepDiJetMet);
+
+    if(!m_compute.diLepDiJetsMetLists)
+      continue;
+
+    for(const LepID::LepID& id1: LepID::it){
+      for(const LepID::LepID& id2: LepID::it){
+        for(const LepIso::LepIso& iso1: LepIso::it){
+          for(const LepIso::LepIso& iso2: LepIso::it){
+            
+            uint16_t combID = LepLepID(id1, id2);
+            LepID::LepID minID = std::min(id1, id2);
+            
+            uint16_t combIso = LepLepIso(iso1, iso2);
+            LepIso::LepIso minIso = std::min(iso1, iso2);
+
+            uint16_t minCombIDIso = LepIDIso(minID, minIso);
+            uint16_t diLepCombIDIso = LepLepIDIso(id1, iso1, id2, iso2);
+           
+            // Store objects for each combined lepton ID/Iso, with jets having minDRjl>cut for leptons corresponding to the loosest combination of the aforementioned ID/Iso
+            
+            // First regular MET
+            if(m_diLepDiJetMet.diLepton->ID[combID] && m_diLepDiJetMet.diLepton->iso[combIso] && m_diLepDiJetMet.diJet->minDRjl_lepIDIso[minCombIDIso] > m_config.jetDRleptonCut){
+              if(fill_diLepDiJetsMet_DRCut)
+                diLepDiJetsMet_DRCut[diLepCombIDIso].push_back(i);
+              
+              // Out of these, store combinations of b-tagging working points
+              for(const BWP::BWP& wp1: BWP::it){
+                for(const BWP::BWP& wp2: BWP::it){
+                  uint16_t combB = JetJetBWP(wp1, wp2);
+                  uint16_t combAll = LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2);
+                  if ((m_diLepDiJetMet.diJet->BWP[combB])
+                          && (std::abs(jets.p4[m_diLepDiJetMet.diJet->idxs.first].Eta()) < m_config.bJetEtaCut)
+                          && (std::abs(jets.p4[m_diLepDiJetMet.diJet->idxs.second].Eta()) < m_config.bJetEtaCut))
+                    diLepDiBJetsMet_DRCut_BWP[combAll].push_back(i);
+                }
+              } // end b-jet loops
+
+            } // end minDRjl>cut
+
+          }
+        } // end lepton iso loops
+      }
+    } // end lepton ID loops
+     
+  } // end diLepDiJet loop
+  
+  // Store objects according to CSVv2, only keeping the first `maxCandidatesPerCombination` of each list: only those are used for the ttbar reconstruction
+  // First regular MET
+  if(&diLepDiBJetsMet_DRCut_BWP != &diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered)
+    diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered = diLepDiBJetsMet_DRCut_BWP;
+  for(const LepID::LepID& id1: LepID::it){
+    for(const LepID::LepID& id2: LepID::it){
+      
+      for(const LepIso::LepIso& iso1: LepIso::it){
+        for(const LepIso::LepIso& iso2: LepIso::it){
+          
+          for(const BWP::BWP& wp1: BWP::it){ 
+            for(const BWP::BWP& wp2: BWP::it){ 
+              
+              uint16_t idx_comb_all = LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2);
+              sortCandidates(diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered[idx_comb_all], m_config.maxCandidatesPerCombination, diJetBTagDiscriminantSorter(jets.CSVv2, diLepDiJetsMet));
+              keepCandidates(diLepDiBJetsMet_DRCut_BWP_PtOrdered[idx_comb_all], m_config.maxCandidatesPerCombination);
+            
+            }
+          }
+        
+        }
+      }
+    
+    }
+  }
+}
+
+void AnalysisCore::reconstructTTBar(const myLorentzVector& met, const NeutrinosSolver& solver) {
+
+  ///////////////////////////
+  //         MTT           //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Reconstructing mtt" << std::endl;
+  #endif
+
+#if TT_MTT_DEBUG
+  std::cout << "Reconstructing ttbar system" << std::endl;
+#endif
+
+  // The solver works in cartesian coordinates: its inputs are taken from the cartesian four-vectors of the objects
+  const NeutrinosSolver::LorentzVector met_p4(met);
+
+  // A candidate belongs to many ID/Iso/b-tagging combinations: it is only reconstructed once, and copied to each of them
+  m_ttbar_sols.resize(diLepDiJetsMet.size());
+  if(m_compute.ttbarRejected)
+    m_ttbar_rejected.resize(diLepDiJetsMet.size());
+  if(m_compute.ttbarSmeared)
+    m_ttbar_smeared.resize(diLepDiJetsMet.size());
+  m_ttbar_done.assign(diLepDiJetsMet.size(), false);
+
+  for(const LepID::LepID& id1: LepID::it){
+    for(const LepID::LepID& id2: LepID::it){
+      
+      for(const LepIso::LepIso& iso1: LepIso::it){
+        for(const LepIso::LepIso& iso2: LepIso::it){
+          
+          for(const BWP::BWP& wp1: BWP::it){ 
+            for(const BWP::BWP& wp2: BWP::it){ 
+              
+              uint16_t idx_comb_all = LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2);
+
+              std::vector<std::vector<TTAnalysis::TTBar>> ttbar_event_sols;
+              std::vector<uint8_t> ttbar_event_rejected;
+              std::vector<TTBarSmeared> ttbar_event_smeared;
+
+              for (const auto& idx: diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered[idx_comb_all]) {
+                if (!m_ttbar_done[idx]) {
+                  reconstructTTBarCandidate(idx, met_p4, solver);
+                  m_ttbar_done[idx] = true;
+                }
+
+                ttbar_event_sols.push_back(m_ttbar_sols[idx]);
+                if (m_compute.ttbarRejected)
+                  ttbar_event_rejected.push_back(m_ttbar_rejected[idx]);
+                if (m_compute.ttbarSmeared)
+                  ttbar_event_smeared.push_back(m_ttbar_smeared[idx]);
+              }
+
+              if(m_compute.ttbarCompact){
+                ttbar_compact[idx_comb_all].clear();
+                for (const auto& ttbar_cand_sols: ttbar_event_sols)
+                  ttbar_compact[idx_comb_all].push_back(std::vector<TTBarCompact>(ttbar_cand_sols.begin(), ttbar_cand_sols.end()));
+              }
+
+              ttbar[idx_comb_all] = std::move(ttbar_event_sols);
+              if(m_compute.ttbarRejected)
+                ttbar_rejected[idx_comb_all] = std::move(ttbar_event_rejected);
+              if(m_compute.ttbarSmeared)
+                ttbar_smeared[idx_comb_all] = std::move(ttbar_event_smeared);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void AnalysisCore::reconstructTTBarCandidate(uint16_t idx, const NeutrinosSolver::LorentzVector& met_p4, const NeutrinosSolver& solver) {
+
+  NeutrinosSolver::LorentzVector lepton1_p4(m_leptons_cartesian[diLepDiJetsMet[idx].diLepton->lidxs.first]);
+  NeutrinosSolver::LorentzVector lepton2_p4(m_leptons_cartesian[diLepDiJetsMet[idx].diLepton->lidxs.second]);
+  NeutrinosSolver::LorentzVector bjet1_p4(m_selJets_cartesian[diLepDiJetsMet[idx].diJet->jidxs.first]);
+  NeutrinosSolver::LorentzVector bjet2_p4(m_selJets_cartesian[diLepDiJetsMet[idx].diJet->jidxs.second]);
+
+#if TT_MTT_DEBUG
+  std::cout << "Objects:" << std::endl;
+  std::cout << "\t Lepton 1: " << lepton1_p4 << std::endl;
+  std::cout << "\t b-jet 1: " << bjet1_p4 << std::endl;
+  std::cout << "\t Lepton 2: " << bjet2_p4 << std::endl;
+  std::cout << "\t b-jet 2: " << bjet2_p4 << std::endl;
+#endif
+
+  // The b-jet assignments with a lepton-b-jet pair above the m_lb endpoint are rejected by the solver before being solved
+  uint8_t rejected = 0;
+
+  NeutrinosSolver::Status status;
+  std::vector<std::pair<NeutrinosSolver::LorentzVector, NeutrinosSolver::LorentzVector>> sols = solver.getNeutrinos(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met_p4, status);
+
+  countNeutrinosCall(sols.size(), status);
+  if (status == NeutrinosSolver::AboveMlbEndpoint)
+    rejected |= 1 << 0;
+
+#if TT_MTT_DEBUG
+  std::cout << "Got " << sols.size() << " solutions for neutrinos (status " << status << ")" << std::endl;
+#endif
+
+  // Solutions of both b-jet assignments, as their masses (computed once from the cartesian coordinates) and tops: the TTBar are only built for the kept ones
+  m_ttbar_order.clear();
+
+  for (auto& sol: sols) {
+#if TT_MTT_DEBUG
+    std::cout << "\t Neutrino 1: " << sol.first << std::endl;
+    std::cout << "\t Neutrino 2: " << sol.second << std::endl;
+#endif
+    const NeutrinosSolver::LorentzVector top1_p4 = lepton1_p4 + bjet1_p4 + sol.first, top2_p4 = lepton2_p4 + bjet2_p4 + sol.second;
+    m_ttbar_order.push_back({myCartesianVector(top1_p4 + top2_p4).M(), uint8_t(m_ttbar_order.size()), top1_p4, top2_p4});
+#if TT_MTT_DEBUG
+    std::cout << "mtt: " << m_ttbar_order.back().mtt << std::endl;
+#endif
+  }
+
+#if TT_MTT_DEBUG
+  std::cout << "Swapping b-jets and recomputing solutions" << std::endl;
+#endif
+
+  // Swap b-jets
+  std::swap(bjet1_p4, bjet2_p4);
+  sols = solver.getNeutrinos(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met_p4, status);
+
+  countNeutrinosCall(sols.size(), status);
+  if (status == NeutrinosSolver::AboveMlbEndpoint)
+    rejected |= 1 << 1;
+
+#if TT_MTT_DEBUG
+  std::cout << "Got " << sols.size() << " solutions for neutrinos (status " << status << ")" << std::endl;
+#endif
+
+  for (auto& sol: sols) {
+#if TT_MTT_DEBUG
+    std::cout << "\t Neutrino 1: " << sol.first << std::endl;
+    std::cout << "\t Neutrino 2: " << sol.second << std::endl;
+#endif
+    const NeutrinosSolver::LorentzVector top1_p4 = lepton1_p4 + bjet1_p4 + sol.first, top2_p4 = lepton2_p4 + bjet2_p4 + sol.second;
+    m_ttbar_order.push_back({myCartesianVector(top1_p4 + top2_p4).M(), uint8_t(m_ttbar_order.size()), top1_p4, top2_p4});
+#if TT_MTT_DEBUG
+    std::cout << "mtt: " << m_ttbar_order.back().mtt << std::endl;
+#endif
+  }
+
+  // Sort solutions by increasing order of mtt, only keeping the first `m_config.ttbarMaxSolutions`
+  const size_t n_kept = (m_config.ttbarMaxSolutions && m_config.ttbarMaxSolutions < m_ttbar_order.size()) ? m_config.ttbarMaxSolutions : m_ttbar_order.size();
+  std::partial_sort(m_ttbar_order.begin(), m_ttbar_order.begin() + n_kept, m_ttbar_order.end());
+
+  std::vector<TTBar>& kept = m_ttbar_sols[idx];
+  kept.clear();
+  kept.reserve(n_kept);
+  for (size_t i = 0; i < n_kept; i++)
+    kept.push_back(TTBar(idx, m_ttbar_order[i].top1_p4, m_ttbar_order[i].top2_p4));
+
+  if (m_compute.ttbarRejected)
+    m_ttbar_rejected[idx] = rejected;
+
+  if (m_compute.ttbarSmeared) {
+    // Seeded by the input objects, so that a candidate gets the same samples in all the jet variations
+    const Lepton& lepton1 = leptons[diLepDiJetsMet[idx].diLepton->lidxs.first];
+    const Lepton& lepton2 = leptons[diLepDiJetsMet[idx].diLepton->lidxs.second];
+    const Jet& bjet1 = selJets[diLepDiJetsMet[idx].diJet->jidxs.first];
+    const Jet& bjet2 = selJets[diLepDiJetsMet[idx].diJet->jidxs.second];
+    const uint64_t seed = RandomStream::seed({m_event_seed, lepton1.isMu, lepton1.idx, lepton2.isMu, lepton2.idx, bjet1.idx, bjet2.idx});
+
+    // The b-jets have been swapped above
+    m_ttbar_smeared[idx] = m_ttbar_smearing->reconstruct(solver, idx, seed, lepton1_p4, lepton2_p4, bjet2_p4, bjet1_p4, met_p4);
+
+    telemetry.neutrinosSmeared += m_ttbar_smearing->solved();
+    telemetry.neutrinosSmearedRejected += m_ttbar_smearing->rejected();
+  }
+}
+
+void AnalysisCore::countNeutrinosCall(size_t solutions, NeutrinosSolver::Status status) {
+  telemetry.neutrinosCalls++;
+  telemetry.neutrinosSolutions += solutions;
+  if(status == NeutrinosSolver::AboveMlbEndpoint)
+    telemetry.neutrinosRejected++;
+  else if(status != NeutrinosSolver::Solved)
+    telemetry.neutrinosFailures++;
+}
+
+void AnalysisCore::matchTrigger(const HLTInputs& hlt) {
+
+  ///////////////////////////
+  //       TRIGGER         //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Trigger" << std::endl;
+  #endif
+
+  if (hlt.exists) {
+
+      if (hlt.paths.empty()) {
+#if TT_HLT_DEBUG
+          std::cout << "No HLT path triggered for this event. Skipping HLT matching." << std::endl;
+#endif
+          return;
+      }
+
+#if TT_HLT_DEBUG
+      std::cout << "HLT path triggered for this event:" << std::endl;
+      for (const std::string& path: hlt.paths) {
+          std::cout << "\t" << path << std::endl;
+      }
+#endif
+
+      /*
+       * Try to match `lepton` with an online object, using a deltaR and a deltaPt cut
+       * Returns the index inside the HLTProducer collection, or -1 if no match is found.
+       */
+      m_hlt_tried_matching.assign(leptons.size(), false);
+
+      auto matchOfflineLepton = [&](uint16_t lidx) {
+
+          Lepton& lepton = leptons[lidx];
+          if (m_hlt_tried_matching[lidx])
+              return lepton.hlt_idx;
+
+#if TT_HLT_DEBUG
+          std::cout << "Trying to match offline lepton: " << std::endl;
+          std::cout << "\tMuon? " << lepton.isMu << " ; Pt: " << lepton.p4.Pt() << " ; Eta: " << lepton.p4.Eta() << " ; Phi: " << lepton.p4.Phi() << " ; E: " << lepton.p4.E() << std::endl;
+#endif
+
+          float min_dr = std::numeric_limits<float>::max();
+
+          int16_t index = -1;
+          for (size_t hlt_object = 0; hlt_object < hlt.object_p4.size(); hlt_object++) {
+
+              float dr = VectorUtil::DeltaR(lepton.p4, hlt.object_p4[hlt_object]);
+              float dpt_over_pt = std::abs(lepton.p4.Pt() - hlt.object_p4[hlt_object].Pt()) / lepton.p4.Pt();
+
+              if (dr > m_config.hltDRCut)
+                  continue;
+
+              if (dpt_over_pt > m_config.hltDPtCut)
+                  continue;
+
+              if (dr < min_dr) {
+                  min_dr = dr;
+                  index = hlt_object;
+              }
+          }
+
+#if TT_HLT_DEBUG
+          if (index != -1) {
+              std::cout << "\033[32mMatched with online object:\033[00m" << std::endl;
+              std::cout << "\tPDG Id: " << hlt.object_pdg_id[index] << " ; Pt: " << hlt.object_p4[index].Pt() << " ; Eta: " << hlt.object_p4[index].Eta() << " ; Phi: " << hlt.object_p4[index].Phi() << " ; E: " << hlt.object_p4[index].E() << std::endl;
+              std::cout << "\tΔR: " << min_dr << " ; ΔPt / Pt: " << std::abs(lepton.p4.Pt() - hlt.object_p4[index].Pt()) / lepton.p4.Pt() << std::endl;
+          } else {
+              std::cout << "\033[31mNo match found\033[00m" << std::endl;
+          }
+#endif
+
+          lepton.hlt_idx = index;
+          m_hlt_tried_matching[lidx] = true;
+          lepton.hlt_DR_matched_object = quantizedDR(min_dr);
+          lepton.hlt_DPt_matched_object = std::abs(lepton.p4.Pt() - hlt.object_p4[index].Pt()) / lepton.p4.Pt();
+
+          return index;
+      };
+
+      // Iterate over all dilepton pairs
+      for (auto& m_diLepton: diLeptons) {
+          // For each lepton of this pair, find the online object
+          m_diLepton.hlt_idxs = IndexPair<int16_t>(
+                  matchOfflineLepton(m_diLepton.lidxs.first),
+                  matchOfflineLepton(m_diLepton.lidxs.second)
+         );
+      }
+
+  }
+}
+
+void AnalysisCore::fillDiLeptonsSummary() {
+
+  ///////////////////////////
+  //   DILEPTON SUMMARY    //
+  ///////////////////////////
+
+  #ifdef _TT_DEBUG_
+    std::cout << "Dilepton summary" << std::endl;
+  #endif
+
+  // Classify the leading DiLepton of each ID/Iso combination once, so that the categories don't have to
+  diLeptons_flavours = 0;
+  for(uint16_t comb = 0; comb < diLeptons_summary.size(); comb++){
+    DiLeptonSummary& summary = diLeptons_summary[comb];
+    summary = DiLeptonSummary();
+    summary.nDiLeptons = diLeptons_IDIso[comb].size();
+
+    if(summary.nDiLeptons == 0)
+      continue;
+
+    summary.diLepIdx = diLeptons_IDIso[comb][0];
+    const DiLepton& m_diLepton = diLeptons[summary.diLepIdx];
+
+    // Many combinations share the same leading DiLepton: re-use what has already been computed
+    if(comb > 0 && diLeptons_summary[comb - 1].diLepIdx == summary.diLepIdx){
+      summary = diLeptons_summary[comb - 1];
+      summary.nDiLeptons = diLeptons_IDIso[comb].size();
+      continue;
+    }
+
+    summary.flavour = m_diLepton.flavour();
+    summary.Mll = m_diLepton.p4.M();
+    summary.isOS = m_diLepton.isOS;
+    summary.hltMatched = m_diLepton.hlt_idxs.first >= 0 && m_diLepton.hlt_idxs.second >= 0;
+    summary.hlt_idxs = m_diLepton.hlt_idxs;
+
+    diLeptons_flavours |= 1 << summary.flavour;
+  }
+}
+
+void AnalysisCore::fillGenInfo(const GenParticlesInputs& gen_particles) {
+
+    ///////////////////////////
+    //       GEN INFO        //
+    ///////////////////////////
+
+    #ifdef _TT_DEBUG_
+      std::cout << "Generator" << std::endl;
+    #endif
+
+    // 'Pruned' particles are from the hard process
+    // 'Packed' particles are stable particles
+
+    // Find once the first-mother chain of every pruned particle: checking if a particle decays from another is then a simple lookup
+    m_gen_ancestry.build(gen_particles.pruned_mothers_index);
+
+#if TT_GEN_DEBUG
+    std::function<void(size_t)> print_mother_chain = [&gen_particles, &print_mother_chain](size_t p) {
+
+        if (gen_particles.pruned_mothers_index[p].empty()) {
+            std::cout << std::endl;
+            return;
+        }
+
+        size_t index = gen_particles.pruned_mothers_index[p][0];
+            std::cout << " <- #" << index << "(" << gen_particles.pruned_pdg_id[index] << ")";
+            print_mother_chain(index);
+    };
+#endif
+
+    // We need to initialize everything to -1, since 0 is a valid entry in the tt_genParticles array
+    gen_t = -1;
+    gen_t_beforeFSR = -1;
+    gen_tbar = -1;
+    gen_tbar_beforeFSR = -1;
+    
+    gen_b = -1;
+    gen_b_beforeFSR = -1;
+    gen_bbar = -1;
+    gen_bbar_beforeFSR = -1;
+    
+    gen_jet1_t = -1;
+    gen_jet1_t_beforeFSR = -1;
+    gen_jet1_tbar = -1;
+    gen_jet1_tbar_beforeFSR = -1;
+    gen_jet2_t = -1;
+    gen_jet2_t_beforeFSR = -1;
+    gen_jet2_tbar = -1;
+    gen_jet2_tbar_beforeFSR = -1;
+    
+    gen_lepton_t = -1;
+    gen_lepton_t_beforeFSR = -1;
+    gen_neutrino_t = -1;
+    gen_neutrino_t_beforeFSR = -1;
+    gen_lepton_tbar = -1;
+    gen_lepton_tbar_beforeFSR = -1;
+    gen_neutrino_tbar = -1;
+    gen_neutrino_tbar_beforeFSR = -1;
+    
+    gen_matched_lepton_t = -1;
+    gen_matched_lepton_tbar = -1;
+
+    size_t gen_index(0);
+    for (size_t i = 0; i < gen_particles.pruned_pdg_id.size(); i++) {
+
+        int16_t pdg_id = gen_particles.pruned_pdg_id[i];
+        uint16_t a_pdg_id = std::abs(pdg_id);
+
+        // We only care of particles with PDG id <= 16 (16 is neutrino tau)
+        if (a_pdg_id > 16)
+            continue;
+
+        GenStatusFlags flags(gen_particles.pruned_status_flags[i]);
+
+        if (! flags.isLastCopy() && ! flags.isFirstCopy())
+            continue;
+
+        if (! flags.fromHardProcess())
+            continue;
+
+#if TT_GEN_DEBUG
+        std::cout << "---" << std::endl;
+        std::cout << "Gen particle #" << i << ": PDG id: " << gen_particles.pruned_pdg_id[i];
+        print_mother_chain(i);
+        flags.dump();
+#endif
+
+        if (pdg_id == 6) {
+            FILL_GEN_COLL(t);
+            continue;
+        } else if (pdg_id == -6) {
+            FILL_GEN_COLL(tbar);
+            continue;
+        }
+
+        if (gen_t == -1 || gen_tbar == -1) {
+            // Don't bother if we don't have found the tops
+            continue;
+        }
+
+        bool from_t_decay = m_gen_ancestry.decaysFrom(i, genParticles[gen_t].pruned_idx);
+        bool from_tbar_decay = m_gen_ancestry.decaysFrom(i, genParticles[gen_tbar].pruned_idx);
+
+        // Only keep particles coming from the tops decay
+        if (! from_t_decay && ! from_tbar_decay)
+            continue;
+
+        if (pdg_id == 5) {
+            // Maybe it's a b coming from the W decay
+            if (!flags.isFirstCopy() && flags.isLastCopy() && gen_b == -1) {
+
+                // This can be a B decaying from a W
+                // However, we can't rely on the presence of the W in the decay chain, as it may be generator specific
+                // Since it's the last copy (ie, after FSR), we can check if this B comes from the B assigned to the W decay (ie, gen_jet1_t_beforeFSR, gen_jet2_t_beforeFSR)
+                // If yes, then it's not the B coming directly from the top decay
+                if ((gen_jet1_t_beforeFSR != -1 && std::abs(genParticles[gen_jet1_t_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet2_t_beforeFSR != -1 && std::abs(genParticles[gen_jet2_t_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet1_tbar_beforeFSR != -1 && std::abs(genParticles[gen_jet1_tbar_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet2_tbar_beforeFSR != -1 && std::abs(genParticles[gen_jet2_tbar_beforeFSR].pdg_id) == 5)) {
+
+#if TT_GEN_DEBUG
+                    std::cout << "A quark coming from W decay is a b" << std::endl;
+#endif
+
+                    if (! (gen_jet1_tbar_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet1_tbar_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet2_tbar_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet2_tbar_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet1_t_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet1_t_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet2_t_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet2_t_beforeFSR].pruned_idx))) {
+#if TT_GEN_DEBUG
+                        std::cout << "This after-FSR b quark is not coming from a W decay" << std::endl;
+#endif
+                        FILL_GEN_COLL(b);
+                        continue;
+                    }
+#if TT_GEN_DEBUG
+                    else {
+                        std::cout << "This after-FSR b quark comes from a W decay" << std::endl;
+                    }
+#endif
+                } else {
+#if TT_GEN_DEBUG
+                    std::cout << "Assigning gen_b" << std::endl;
+#endif
+                    FILL_GEN_COLL(b);
+                    continue;
+                }
+            } else if (flags.isFirstCopy() && gen_b_beforeFSR == -1) {
+                FILL_GEN_COLL(b);
+                continue;
+            } else {
+#if TT_GEN_DEBUG
+                std::cout << "This should not happen!" << std::endl;
+#endif
+            }
+        } else if (pdg_id == -5) {
+            if (!flags.isFirstCopy() && flags.isLastCopy() && gen_bbar == -1) {
+
+                // This can be a B decaying from a W
+                // However, we can't rely on the presence of the W in the decay chain, as it may be generator specific
+                // Since it's the last copy (ie, after FSR), we can check if this B comes from the B assigned to the W decay (ie, gen_jet1_t_beforeFSR, gen_jet2_t_beforeFSR)
+                // If yes, then it's not the B coming directly from the top decay
+                if ((gen_jet1_t_beforeFSR != -1 && std::abs(genParticles[gen_jet1_t_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet2_t_beforeFSR != -1 && std::abs(genParticles[gen_jet2_t_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet1_tbar_beforeFSR != -1 && std::abs(genParticles[gen_jet1_tbar_beforeFSR].pdg_id) == 5) ||
+                    (gen_jet2_tbar_beforeFSR != -1 && std::abs(genParticles[gen_jet2_tbar_beforeFSR].pdg_id) == 5)) {
+
+#if TT_GEN_DEBUG
+                    std::cout << "A quark coming from W decay is a bbar" << std::endl;
+#endif
+
+                    if (! (gen_jet1_tbar_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet1_tbar_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet2_tbar_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet2_tbar_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet1_t_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet1_t_beforeFSR].pruned_idx)) &&
+                        ! (gen_jet2_t_beforeFSR != -1 && m_gen_ancestry.decaysFrom(i, genParticles[gen_jet2_t_beforeFSR].pruned_idx))) {
+#if TT_GEN_DEBUG
+                        std::cout << "This after-fsr b anti-quark is not coming from a W decay" << std::endl;
+#endif
+                        FILL_GEN_COLL(bbar);
+                        continue;
+                    }
+#if TT_GEN_DEBUG
+                    else {
+                        std::cout << "This after-fsr b anti-quark comes from a W decay" << std::endl;
+                    }
+#endif
+                } else {
+#if TT_GEN_DEBUG
+                    std::cout << "Assigning gen_bbar" << std::endl;
+#endif
+                    FILL_GEN_COLL(bbar);
+                    continue;
+                }
+            } else if (flags.isFirstCopy() && gen_bbar_beforeFSR == -1) {
+                FILL_GEN_COLL(bbar);
+                continue;
+            }
+        }
+
+        if ((gen_tbar == -1) || (gen_t == -1))
+            continue;
+
+        if (gen_t != -1 && from_t_decay) {
+#if TT_GEN_DEBUG
+        std::cout << "Coming from the top chain decay" << std::endl;
+#endif
+            if (a_pdg_id >= 1 && a_pdg_id <= 5) {
+                FILL_GEN_COLL2(jet1_t, jet2_t, "Error: more than two quarks coming from top decay");
+            } else if (a_pdg_id == 11 || a_pdg_id == 13 || a_pdg_id == 15) {
+                FILL_GEN_COLL(lepton_t);
+            } else if (a_pdg_id == 12 || a_pdg_id == 14 || a_pdg_id == 16) {
+                FILL_GEN_COLL(neutrino_t);
+            } else {
+                std::cout << "Error: unknown particle coming from top decay - #" << i << " ; PDG Id: " << pdg_id << std::endl;
+            }
+        } else if (gen_tbar != -1 && from_tbar_decay) {
+#if TT_GEN_DEBUG
+        std::cout << "Coming from the anti-top chain decay" << std::endl;
+#endif
+            if (a_pdg_id >= 1 && a_pdg_id <= 5) {
+                FILL_GEN_COLL2(jet1_tbar, jet2_tbar, "Error: more than two quarks coming from anti-top decay");
+            } else if (a_pdg_id == 11 || a_pdg_id == 13 || a_pdg_id == 15) {
+                FILL_GEN_COLL(lepton_tbar);
+            } else if (a_pdg_id == 12 || a_pdg_id == 14 || a_pdg_id == 16) {
+                FILL_GEN_COLL(neutrino_tbar);
+            } else {
+                std::cout << "Error: unknown particle coming from anti-top decay - #" << i << " ; PDG Id: " << pdg_id << std::endl;
+            }
+        }
+    }
+
+    if (!gen_t || !gen_tbar) {
+#if TT_GEN_DEBUG
+        std::cout << "This is not a ttbar event" << std::endl;
+#endif
+        gen_ttbar_decay_type = NotTT;
+        return;
+    }
+
+    if ((gen_jet1_t != -1) && (gen_jet2_t != -1) && (gen_jet1_tbar != -1) && (gen_jet2_tbar != -1)) {
+#if TT_GEN_DEBUG
+        std::cout << "Hadronic ttbar decay" << std::endl;
+#endif
+        gen_ttbar_decay_type = Hadronic;
+    } else if (
+            ((gen_lepton_t != -1) && (gen_lepton_tbar == -1)) ||
+            ((gen_lepton_t == -1) && (gen_lepton_tbar != -1))
+            ) {
+
+#if TT_GEN_DEBUG
+        std::cout << "Semileptonic ttbar decay" << std::endl;
+#endif
+
+        uint16_t lepton_pdg_id;
+        if (gen_lepton_t != -1)
+            lepton_pdg_id = std::abs(genParticles[gen_lepton_t].pdg_id);
+        else
+            lepton_pdg_id = std::abs(genParticles[gen_lepton_tbar].pdg_id);
+
+        if (lepton_pdg_id == 11)
+            gen_ttbar_decay_type = Semileptonic_e;
+        else if (lepton_pdg_id == 13)
+            gen_ttbar_decay_type = Semileptonic_mu;
+        else
+            gen_ttbar_decay_type = Semileptonic_tau;
+    } else if (gen_lepton_t != -1 && gen_lepton_tbar != -1) {
+        uint16_t lepton_t_pdg_id = std::abs(genParticles[gen_lepton_t].pdg_id);
+        uint16_t lepton_tbar_pdg_id = std::abs(genParticles[gen_lepton_tbar].pdg_id);
+
+#if TT_GEN_DEBUG
+        std::cout << "Dileptonic ttbar decay" << std::endl;
+#endif
+
+        if (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 11)
+            gen_ttbar_decay_type = Dileptonic_ee;
+        else if (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 13)
+            gen_ttbar_decay_type = Dileptonic_mumu;
+        else if (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 15)
+            gen_ttbar_decay_type = Dileptonic_tautau;
+        else if (
+                (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 13) ||
+                (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 11)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_mue;
+        }
+        else if (
+                (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 15) ||
+                (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 11)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_etau;
+        }
+        else if (
+                (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 15) ||
+                (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 13)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_mutau;
+        } else {
+            std::cout << "Error: unknown dileptonic ttbar decay." << std::endl;
+            gen_ttbar_decay_type = NotTT;
+            return;
+        }
+    } else {
+        std::cout << "Error: unknown ttbar decay." << std::endl;
+        gen_ttbar_decay_type = UnknownTT;
+    }
+
+    gen_ttbar_p4 = genParticles[gen_t].p4 + genParticles[gen_tbar].p4;
+    if (gen_t_beforeFSR != -1 && gen_tbar_beforeFSR != -1)
+        gen_ttbar_beforeFSR_p4 = genParticles[gen_t_beforeFSR].p4 + genParticles[gen_tbar_beforeFSR].p4;
+
+    gen_t_tbar_deltaR = quantizedDR(VectorUtil::DeltaR(genParticles[gen_t].p4, genParticles[gen_tbar].p4));
+    gen_t_tbar_deltaEta = quantizedDEta(DeltaEta(genParticles[gen_t].p4, genParticles[gen_tbar].p4));
+    gen_t_tbar_deltaPhi = quantizedDPhi(VectorUtil::DeltaPhi(genParticles[gen_t].p4, genParticles[gen_tbar].p4));
+
+    gen_b_bbar_deltaR = quantizedDR(VectorUtil::DeltaR(genParticles[gen_b].p4, genParticles[gen_bbar].p4));
+
+    // The leptons are matched by `matchGenLeptons`, once they are selected
+    m_matchGenLeptons = gen_ttbar_decay_type > Hadronic;
+
+    if (gen_b > -1 && gen_lepton_t > -1) {
+        gen_b_lepton_t_deltaR = quantizedDR(VectorUtil::DeltaR(genParticles[gen_b].p4, genParticles[gen_lepton_t].p4));
+    }
+
+    if (gen_bbar > -1 && gen_lepton_tbar > -1) {
+        gen_bbar_lepton_tbar_deltaR = quantizedDR(VectorUtil::DeltaR(genParticles[gen_bbar].p4, genParticles[gen_lepton_tbar].p4));
+    }
+
+    // The jets are matched by `analyzeJets`, for each jet variation
+    m_matchGenJets = true;
+}
+
+// Match the leptons from the top decays to the selected leptons
+void AnalysisCore::matchGenLeptons() {
+
+    const bool fill_gen_lepton_t_deltaR = isBranchEnabled("gen_lepton_t_deltaR");
+    const bool fill_gen_lepton_tbar_deltaR = isBranchEnabled("gen_lepton_tbar_deltaR");
+
+    float min_dr_lepton_t = std::numeric_limits<float>::max();
+    float min_dr_lepton_tbar = std::numeric_limits<float>::max();
+
+    size_t lepton_index = 0;
+    for (const auto& lepton: leptons) {
+
+        if (gen_lepton_t != -1) {
+            float dr = VectorUtil::DeltaR(genParticles[gen_lepton_t].p4, lepton.p4);
+            if (dr < min_dr_lepton_t &&
+                    (std::abs(lepton.pdg_id()) == std::abs(genParticles[gen_lepton_t].pdg_id))) {
+                min_dr_lepton_t = dr;
+                gen_matched_lepton_t = lepton_index;
+            }
+            if (fill_gen_lepton_t_deltaR)
+                gen_lepton_t_deltaR.push_back(quantizedDR(dr));
+        }
+
+        if (gen_lepton_tbar != -1) {
+            float dr = VectorUtil::DeltaR(genParticles[gen_lepton_tbar].p4, lepton.p4);
+            if (dr < min_dr_lepton_tbar &&
+                    (std::abs(lepton.pdg_id()) == std::abs(genParticles[gen_lepton_tbar].pdg_id))) {
+                min_dr_lepton_tbar = dr;
+                gen_matched_lepton_tbar = lepton_index;
+            }
+            if (fill_gen_lepton_tbar_deltaR)
+                gen_lepton_tbar_deltaR.push_back(quantizedDR(dr));
+        }
+
+        lepton_index++;
+    }
+}
+
+// Match the b quarks from the top decays to the selected jets
+void AnalysisCore::matchGenJets() {
+
+    // Match b quarks to jets
+
+    const float MIN_DR_JETS = 0.8;
+
+    // The ID/Iso combinations select overlapping subsets of `selJets`: compute the DeltaR of each b quark to each selected jet once,
+    // stored as m_gen_b_jet_deltaR[parton * selJets.size() + jet]
+    enum { B, BBar, BBeforeFSR, BBarBeforeFSR, Partons };
+    const int16_t partons[Partons] = { gen_b, gen_bbar, gen_b_beforeFSR, gen_bbar_beforeFSR };
+    const size_t nJets = selJets.size();
+
+    m_gen_b_jet_deltaR.resize(Partons * nJets);
+    for (size_t parton = 0; parton < Partons; parton++) {
+      // A b quark which has not been found in the gen particles is matched to no jet
+      if (partons[parton] < 0) {
+        std::fill(m_gen_b_jet_deltaR.begin() + parton * nJets, m_gen_b_jet_deltaR.begin() + (parton + 1) * nJets, std::numeric_limits<float>::max());
+        continue;
+      }
+      for (size_t jet = 0; jet < nJets; jet++)
+        m_gen_b_jet_deltaR[parton * nJets + jet] = VectorUtil::DeltaR(genParticles[partons[parton]].p4, selJets[jet].p4);
+    }
+
+    std::vector<std::vector<float>>* deltaR[Partons] = {
+      isBranchEnabled("gen_b_deltaR") ? &gen_b_deltaR : nullptr,
+      isBranchEnabled("gen_bbar_deltaR") ? &gen_bbar_deltaR : nullptr,
+      isBranchEnabled("gen_b_beforeFSR_deltaR") ? &gen_b_beforeFSR_deltaR : nullptr,
+      isBranchEnabled("gen_bbar_beforeFSR_deltaR") ? &gen_bbar_beforeFSR_deltaR : nullptr
+    };
+    std::vector<int8_t>* matched[Partons] = { &gen_matched_b, &gen_matched_bbar, &gen_matched_b_beforeFSR, &gen_matched_bbar_beforeFSR };
+
+    for (const auto& id: LepID::it) {
+      for (const auto& iso: LepIso::it) {
+          uint16_t IdWP = LepIDIso(id, iso);
+          const std::vector<uint16_t>& combJets = selJets_selID_DRCut[IdWP];
+
+          for (size_t parton = 0; parton < Partons; parton++) {
+              const float* jetsDeltaR = &m_gen_b_jet_deltaR[parton * nJets];
+
+              float min_dr = MIN_DR_JETS;
+              int8_t local_matched = -1;
+              for (size_t jet_index = 0; jet_index < combJets.size(); jet_index++) {
+                  const float dr = jetsDeltaR[combJets[jet_index]];
+                  if (dr < min_dr) {
+                      min_dr = dr;
+                      local_matched = jet_index;
+                  }
+              }
+              (*matched[parton])[IdWP] = local_matched;
+
+              if (deltaR[parton]) {
+                  std::vector<float>& combDeltaR = (*deltaR[parton])[IdWP];
+                  combDeltaR.reserve(combJets.size());
+                  for (const uint16_t& jet: combJets)
+                      combDeltaR.push_back(quantizedDR(jetsDeltaR[jet]));
+              }
+          }
+      }
+    }
+}
+
+// Reduce the precision of the stored angular variables, as configured
+// The lepton and jet ones are reduced separately, as the jet ones are recomputed for each jet variation.
+// The trigger and gen matching ones are reduced when they are stored, by their own stages.
+bool AnalysisCore::quantizeAngularVariables() const {
+  return m_config.DRMantissaBits < 23 || m_config.DEtaMantissaBits < 23 || m_config.DPhiMantissaBits < 23;
+}
+
+float AnalysisCore::quantizedDR(float value) const {
+  return truncateMantissa(value, m_config.DRMantissaBits);
+}
+
+float AnalysisCore::quantizedDEta(float value) const {
+  return truncateMantissa(value, m_config.DEtaMantissaBits);
+}
+
+float AnalysisCore::quantizedDPhi(float value) const {
+  return truncateMantissa(value, m_config.DPhiMantissaBits);
+}
+
+void AnalysisCore::quantizeLeptonAngularVariables() {
+
+  if(!quantizeAngularVariables())
+    return;
+
+  auto DR = [this](float& value) { value = quantizedDR(value); };
+  auto DEta = [this](float& value) { value = quantizedDEta(value); };
+  auto DPhi = [this](float& value) { value = quantizedDPhi(value); };
+
+  for(DiLepton& m_diLepton: diLeptons){
+    DR(m_diLepton.DR); DEta(m_diLepton.DEta); DPhi(m_diLepton.DPhi);
+  }
+}
+
+void AnalysisCore::quantizeJetAngularVariables() {
+
+  if(!quantizeAngularVariables())
+    return;
+
+  auto DR = [this](float& value) { value = quantizedDR(value); };
+  auto DEta = [this](float& value) { value = quantizedDEta(value); };
+  auto DPhi = [this](float& value) { value = quantizedDPhi(value); };
+
+  for(Jet& m_jet: selJets){
+    for(float& minDRjl: m_jet.minDRjl_lepIDIso)
+      DR(minDRjl);
+  }
+
+  for(DiJet& m_diJet: diJets){
+    DR(m_diJet.DR); DEta(m_diJet.DEta); DPhi(m_diJet.DPhi);
+    for(float& minDRjl: m_diJet.minDRjl_lepIDIso)
+      DR(minDRjl);
+  }
+
+  auto quantizeDiLepDiJet = [&](DiLepDiJet& m_diLepDiJet) {
+    DR(m_diLepDiJet.DR_ll_jj); DEta(m_diLepDiJet.DEta_ll_jj); DPhi(m_diLepDiJet.DPhi_ll_jj);
+    DR(m_diLepDiJet.minDRjl); DR(m_diLepDiJet.maxDRjl);
+    DEta(m_diLepDiJet.minDEtajl); DEta(m_diLepDiJet.maxDEtajl);
+    DPhi(m_diLepDiJet.minDPhijl); DPhi(m_diLepDiJet.maxDPhijl);
+  };
+
+  for(DiLepDiJet& m_diLepDiJet: diLepDiJets)
+    quantizeDiLepDiJet(m_diLepDiJet);
+
+  for(DiLepDiJetMet& m_diLepDiJetMet: diLepDiJetsMet){
+    quantizeDiLepDiJet(m_diLepDiJetMet);
+
+    DR(m_diLepDiJetMet.DR_ll_Met); DR(m_diLepDiJetMet.DR_jj_Met); DR(m_diLepDiJetMet.DR_lljj_Met);
+    DEta(m_diLepDiJetMet.DEta_ll_Met); DEta(m_diLepDiJetMet.DEta_jj_Met); DEta(m_diLepDiJetMet.DEta_lljj_Met);
+    DPhi(m_diLepDiJetMet.DPhi_ll_Met); DPhi(m_diLepDiJetMet.DPhi_jj_Met); DPhi(m_diLepDiJetMet.DPhi_lljj_Met);
+
+    DR(m_diLepDiJetMet.minDR_l_Met); DR(m_diLepDiJetMet.maxDR_l_Met);
+    DR(m_diLepDiJetMet.minDR_j_Met); DR(m_diLepDiJetMet.maxDR_j_Met);
+    DEta(m_diLepDiJetMet.minDEta_l_Met); DEta(m_diLepDiJetMet.maxDEta_l_Met);
+    DEta(m_diLepDiJetMet.minDEta_j_Met); DEta(m_diLepDiJetMet.maxDEta_j_Met);
+    DPhi(m_diLepDiJetMet.minDPhi_l_Met); DPhi(m_diLepDiJetMet.maxDPhi_l_Met);
+    DPhi(m_diLepDiJetMet.minDPhi_j_Met); DPhi(m_diLepDiJetMet.maxDPhi_j_Met);
+  }
+
+  for(auto& ttbar_comb: ttbar){
+    for(auto& ttbar_sols: ttbar_comb){
+      for(TTBar& m_ttbar: ttbar_sols){
+        DR(m_ttbar.DR_tt); DEta(m_ttbar.DEta_tt); DPhi(m_ttbar.DPhi_tt);
+      }
+    }
+  }
+}
+
+bool AnalysisCore::passJetID(const JetsInputs& jets, uint16_t index) const {
+
+  switch(m_config.jetID){
+    case JetID::L:
+      return jets.passLooseID[index];
+    case JetID::T:
+      return jets.passTightID[index];
+    case JetID::TLV:
+      return jets.passTightLeptonVetoID[index];
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,233 @@
+#include <cp3_llbb/TTAnalysis/interface/EventCapture.h>
+#include <cp3_llbb/TTAnalysis/interface/SharedByPath.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace TTAnalysis {
+
+  namespace {
+
+    const char MAGIC[8] = { 'T', 'T', 'C', 'A', 'P', 'T', 'U', 'R' };
+    const uint32_t VERSION = 1;
+
+    // Serialization of the EventInputs fields into a record
+
+    class RecordWriter {
+      public:
+        RecordWriter(std::string& buffer): m_buffer(buffer) {
+          m_buffer.clear();
+        }
+
+        template<typename T>
+        void value(const T& value) {
+          static_assert(std::is_arithmetic<T>::value, "Only numbers can be written as is");
+          m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void value(const myLorentzVector& p4) {
+          value<float>(p4.Pt());
+          value<float>(p4.Eta());
+          value<float>(p4.Phi());
+          value<float>(p4.E());
+        }
+
+        void value(const std::string& str) {
+          value<uint32_t>(str.size());
+          m_buffer.append(str);
+        }
+
+        template<typename T>
+        void value(const std::vector<T>& array) {
+          value<uint32_t>(array.size());
+          for (const T& item: array)
+            value(item);
+        }
+
+        template<typename T>
+        void value(const Column<T>& column) {
+          value<uint32_t>(column.size());
+          for (const T& item: column)
+            value(item);
+        }
+
+      private:
+        std::string& m_buffer;
+    };
+
+    class RecordReader {
+      public:
+        RecordReader(const std::string& buffer, const std::string& path):
+          m_current(buffer.data()), m_end(buffer.data() + buffer.size()), m_path(path) {}
+
+        template<typename T>
+        void value(T& value) {
+          static_assert(std::is_arithmetic<T>::value, "Only numbers can be read as is");
+          std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        }
+
+        void value(myLorentzVector& p4) {
+          float pt, eta, phi, e;
+          value(pt); value(eta); value(phi); value(e);
+          p4 = myLorentzVector(pt, eta, phi, e);
+        }
+
+        void value(std::string& str) {
+          uint32_t size;
+          value(size);
+          str.assign(take(size), size);
+        }
+
+        template<typename T>
+        void value(std::vector<T>& array) {
+          uint32_t size;
+          value(size);
+          array.resize(size);
+          for (T& item: array)
+            value(item);
+        }
+
+        // Read into the column's own storage, reusing its allocation
+        template<typename T>
+        void value(Column<T>& column) {
+          std::vector<T> array;
+          column.swap(array);
+          value(array);
+          column.swap(array);
+        }
+
+        bool done() const {
+          return m_current == m_end;
+        }
+
+      private:
+        const char* take(size_t size) {
+          if (size > static_cast<size_t>(m_end - m_current))
+            throw std::runtime_error("Corrupted event record in capture file " + m_path);
+          const char* data = m_current;
+          m_current += size;
+          return data;
+        }
+
+        const char* m_current;
+        const char* const m_end;
+        const std::string& m_path;
+    };
+
+    // Single list of the serialized fields, shared by the reader and the writer
+    template<typename Record, typename Inputs>
+    void serialize(Record& record, Inputs& inputs) {
+      record.value(inputs.run);
+      record.value(inputs.lumi);
+      record.value(inputs.event);
+      record.value(inputs.isRealData);
+
+      record.value(inputs.electrons.p4);
+      record.value(inputs.electrons.charge);
+      record.value(inputs.electrons.vetoID);
+      record.value(inputs.electrons.looseID);
+      record.value(inputs.electrons.mediumID);
+      record.value(inputs.electrons.tightID);
+      record.value(inputs.electrons.relativeIsoR03_withEA);
+
+      record.value(inputs.muons.p4);
+      record.value(inputs.muons.charge);
+      record.value(inputs.muons.isLoose);
+      record.value(inputs.muons.isMedium);
+      record.value(inputs.muons.isTight);
+      record.value(inputs.muons.relativeIsoR04_deltaBeta);
+
+      record.value(inputs.jets.p4);
+      record.value(inputs.jets.passLooseID);
+      record.value(inputs.jets.passTightID);
+      record.value(inputs.jets.passTightLeptonVetoID);
+      record.value(inputs.jets.CSVv2);
+
+      record.value(inputs.met_p4);
+
+      record.value(inputs.hlt.exists);
+      record.value(inputs.hlt.paths);
+      record.value(inputs.hlt.object_p4);
+      record.value(inputs.hlt.object_pdg_id);
+
+      record.value(inputs.genParticles.pruned_p4);
+      record.value(inputs.genParticles.pruned_pdg_id);
+      record.value(inputs.genParticles.pruned_status_flags);
+      record.value(inputs.genParticles.pruned_mothers_index);
+    }
+
+  }
+
+  EventCaptureWriter::EventCaptureWriter(const std::string& path):
+    m_file(path, std::ios::binary | std::ios::trunc) {
+
+    if (!m_file)
+      throw std::runtime_error("Cannot open capture file " + path + " for writing");
+
+    m_file.write(MAGIC, sizeof(MAGIC));
+    m_file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+  }
+
+  std::shared_ptr<EventCaptureWriter> EventCaptureWriter::shared(const std::string& path) {
+    return sharedByPath<EventCaptureWriter>(path);
+  }
+
+  void EventCaptureWriter::write(const EventInputs& inputs) {
+
+    // Record being serialized, kept by each thread to reuse its allocation
+    thread_local std::string buffer;
+
+    RecordWriter record(buffer);
+    serialize(record, inputs);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const uint32_t size = buffer.size();
+    m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    m_file.write(buffer.data(), size);
+
+    if (!m_file)
+      throw std::runtime_error("Error while writing the capture file");
+
+    m_events++;
+  }
+
+  EventCaptureReader::EventCaptureReader(const std::string& path):
+    m_file(path, std::ios::binary), m_path(path) {
+
+    if (!m_file)
+      throw std::runtime_error("Cannot open capture file " + path);
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    m_file.read(magic, sizeof(magic));
+    m_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+    if (!m_file || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+      throw std::runtime_error(path + " is not a capture file");
+
+    if (version != VERSION)
+      throw std::runtime_error("Unsupported version " + std::to_string(version) + " of capture file " + path);
+  }
+
+  bool EventCaptureReader::read(EventInputs& inputs) {
+
+    uint32_t size;
+    if (!m_file.read(reinterpret_cast<char*>(&size), sizeof(size)))
+      return false;
+
+    m_buffer.resize(size);
+    if (!m_file.read(&m_buffer[0], size))
+      throw std::runtime_error("Truncated event record in capture file " + m_path);
+
+    RecordReader record(m_buffer, m_path);
+    serialize(record, inputs);
+
+    if (!record.done())
+      throw std::runtime_error("Corrupted event record in capture file " + m_path);
+
+    return true;
+  }
+
+}
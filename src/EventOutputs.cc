@@ -0,0 +1,38 @@
+#include <cp3_llbb/TTAnalysis/interface/EventOutputs.h>
+
+namespace TTAnalysis {
+
+  namespace {
+
+    template<typename T>
+    void resetOutput(std::vector<T>& output) {
+      output.clear();
+    }
+
+    template<typename T>
+    void resetOutput(T& output) {
+      output = T();
+    }
+
+  }
+
+  void EventOutputs::clear() {
+
+#define TT_OUTPUT(NAME, ...) resetOutput(NAME);
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    diLeptons_summary.fill(DiLeptonSummary());
+    diLeptons_flavours = 0;
+  }
+
+  void EventOutputs::clearJetOutputs() {
+
+#define TT_OUTPUT(NAME, ...)
+#define TT_JET_OUTPUT(NAME, ...) resetOutput(NAME);
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_JET_OUTPUT
+#undef TT_OUTPUT
+  }
+
+}
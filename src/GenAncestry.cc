@@ -0,0 +1,59 @@
+#include <cp3_llbb/TTAnalysis/interface/GenAncestry.h>
+
+#include <utility>
+
+namespace TTAnalysis {
+
+  void GenAncestry::build(const Column<std::vector<uint16_t>>& mothers_index) {
+
+    const size_t n = mothers_index.size();
+
+    m_entry.assign(n, -1);
+    m_exit.assign(n, -1);
+    m_parent.assign(n, -1);
+
+    // Children of each particle, stored contiguously: children of `i` are m_children[m_first_child[i] .. m_first_child[i + 1]]
+    m_first_child.assign(n + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+      if (mothers_index[i].empty() || mothers_index[i][0] >= n)
+        continue;
+      m_parent[i] = mothers_index[i][0];
+      m_first_child[m_parent[i] + 1]++;
+    }
+    for (size_t i = 0; i < n; i++)
+      m_first_child[i + 1] += m_first_child[i];
+
+    m_children.resize(m_first_child[n]);
+    std::vector<uint32_t> fill(m_first_child.begin(), m_first_child.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+      if (m_parent[i] >= 0)
+        m_children[fill[m_parent[i]]++] = i;
+    }
+
+    // Iterative depth-first walk starting from each particle without mother
+    int32_t position = 0;
+    for (size_t root = 0; root < n; root++) {
+      if (m_parent[root] >= 0)
+        continue;
+
+      m_stack.clear();
+      m_entry[root] = position++;
+      m_stack.push_back(std::make_pair(root, m_first_child[root]));
+
+      while (!m_stack.empty()) {
+        std::pair<uint32_t, uint32_t>& top = m_stack.back();
+
+        if (top.second == m_first_child[top.first + 1]) {
+          m_exit[top.first] = position - 1;
+          m_stack.pop_back();
+          continue;
+        }
+
+        uint32_t child = m_children[top.second++];
+        m_entry[child] = position++;
+        m_stack.push_back(std::make_pair(child, m_first_child[child]));
+      }
+    }
+  }
+
+}
@@ -0,0 +1,238 @@
+#include <cp3_llbb/TTAnalysis/interface/Histograms.h>
+#include <cp3_llbb/TTAnalysis/interface/SharedByPath.h>
+
+#include <TFile.h>
+#include <TH1F.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace TTAnalysis {
+
+  namespace {
+
+    // (index in the outputs, lepton ID/Iso combination defining the flavour category) of each combination, by name
+    typedef std::map<std::string, std::pair<uint16_t, uint16_t>> Combinations;
+
+    Combinations combinations(const HistogramVariable::Variable& variable) {
+      Combinations result;
+
+      for(const LepID::LepID& id1: LepID::it){
+        for(const LepIso::LepIso& iso1: LepIso::it){
+
+          if(variable == HistogramVariable::NBJets || variable == HistogramVariable::Mjj){
+            const uint16_t diLepton = LepLepIDIso(id1, iso1, id1, iso1);
+            for(const BWP::BWP& wp1: BWP::it){
+              if(variable == HistogramVariable::NBJets){
+                result[LepIDIsoJetBWPStr(id1, iso1, wp1)] = std::make_pair(LepIDIsoJetBWP(id1, iso1, wp1), diLepton);
+                continue;
+              }
+              for(const BWP::BWP& wp2: BWP::it)
+                result[LepIDIsoJetJetBWPStr(id1, iso1, wp1, wp2)] = std::make_pair(LepIDIsoJetJetBWP(id1, iso1, wp1, wp2), diLepton);
+            }
+            continue;
+          }
+
+          for(const LepID::LepID& id2: LepID::it){
+            for(const LepIso::LepIso& iso2: LepIso::it){
+              const uint16_t diLepton = LepLepIDIso(id1, iso1, id2, iso2);
+              if(variable == HistogramVariable::Mll){
+                result[LepLepIDIsoStr(id1, iso1, id2, iso2)] = std::make_pair(diLepton, diLepton);
+                continue;
+              }
+              for(const BWP::BWP& wp1: BWP::it){
+                for(const BWP::BWP& wp2: BWP::it)
+                  result[LepLepIDIsoJetJetBWPStr(id1, iso1, id2, iso2, wp1, wp2)] = std::make_pair(LepLepIDIsoJetJetBWP(id1, iso1, id2, iso2, wp1, wp2), diLepton);
+              }
+            }
+          }
+        }
+      }
+
+      return result;
+    }
+
+    // Value of the variable for the given combination. Returns false if the event has none (e.g. no ttbar candidate).
+    bool value(const EventOutputs& outputs, const HistogramVariable::Variable& variable, uint16_t combination, double& result) {
+      switch(variable){
+        case HistogramVariable::Mll:
+          result = outputs.diLeptons_summary[combination].Mll;
+          return true;
+
+        case HistogramVariable::NBJets:
+          result = outputs.selBJets_DRCut_BWP_CSVv2Ordered[combination].size();
+          return true;
+
+        case HistogramVariable::Mjj:
+          if(outputs.diBJets_DRCut_BWP_CSVv2Ordered[combination].empty())
+            return false;
+          result = outputs.diJets[outputs.diBJets_DRCut_BWP_CSVv2Ordered[combination][0]].p4.M();
+          return true;
+
+        case HistogramVariable::Mlljj:
+          if(outputs.diLepDiBJets_DRCut_BWP_CSVv2Ordered[combination].empty())
+            return false;
+          result = outputs.diLepDiJets[outputs.diLepDiBJets_DRCut_BWP_CSVv2Ordered[combination][0]].p4.M();
+          return true;
+
+        case HistogramVariable::Mtt:
+          // The solutions of each candidate are sorted by increasing mtt
+          if(outputs.ttbar[combination].empty() || outputs.ttbar[combination][0].empty())
+            return false;
+          result = outputs.ttbar[combination][0][0].p4.M();
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+  }
+
+  Histogram::Histogram(uint32_t bins, double min, double max):
+    m_min(min), m_max(max), m_sumw(bins + 2), m_sumw2(bins + 2) {
+
+    if(bins == 0 || !(min < max))
+      throw std::invalid_argument("Invalid histogram binning");
+  }
+
+  void Histogram::fill(double value, double weight) {
+    uint32_t bin;
+    if(std::isnan(value) || value >= m_max)
+      bin = bins() + 1;
+    else if(value < m_min)
+      bin = 0;
+    else
+      bin = 1 + std::min<uint32_t>(bins() - 1, (value - m_min) / (m_max - m_min) * bins());
+
+    m_entries++;
+    m_sumw[bin] += weight;
+    m_sumw2[bin] += weight * weight;
+  }
+
+  void Histogram::merge(const Histogram& other) {
+    if(other.bins() != bins() || other.m_min != m_min || other.m_max != m_max)
+      throw std::invalid_argument("Cannot merge histograms with different binnings");
+
+    m_entries += other.m_entries;
+    for(uint32_t bin = 0; bin < m_sumw.size(); bin++){
+      m_sumw[bin] += other.m_sumw[bin];
+      m_sumw2[bin] += other.m_sumw2[bin];
+    }
+  }
+
+  HistogramAggregator::HistogramAggregator(const std::vector<HistogramConfig>& configs) {
+
+    for(const HistogramConfig& config: configs){
+      const Combinations available = combinations(config.variable);
+
+      for(const std::string& name: config.combinations){
+        auto combination = available.find(name);
+        if(combination == available.end())
+          throw std::invalid_argument("Unknown combination '" + name + "' for histogram '" + config.name + "' of " + HistogramVariable::map.at(config.variable));
+
+        m_entries.push_back({ config.variable, combination->second.first, combination->second.second, m_histograms.size() });
+        for(const DiLepFlavour::DiLepFlavour& flavour: DiLepFlavour::it){
+          m_names.push_back(config.name + "_" + name + "_" + DiLepFlavour::map.at(flavour));
+          m_histograms.push_back(Histogram(config.bins, config.min, config.max));
+        }
+      }
+    }
+  }
+
+  std::set<std::string> HistogramAggregator::requiredOutputs(const std::vector<HistogramConfig>& configs) {
+    std::set<std::string> outputs;
+
+    for(const HistogramConfig& config: configs){
+      switch(config.variable){
+        case HistogramVariable::NBJets:
+          outputs.insert("selBJets_DRCut_BWP_CSVv2Ordered");
+          break;
+        case HistogramVariable::Mjj:
+          outputs.insert({ "diJets", "diBJets_DRCut_BWP_CSVv2Ordered" });
+          break;
+        case HistogramVariable::Mlljj:
+          outputs.insert({ "diLepDiJets", "diLepDiBJets_DRCut_BWP_CSVv2Ordered" });
+          break;
+        case HistogramVariable::Mtt:
+          outputs.insert("ttbar");
+          break;
+        default:
+          // Mll is read from the DiLepton summary, which is always filled
+          break;
+      }
+    }
+
+    return outputs;
+  }
+
+  void HistogramAggregator::fill(const EventOutputs& outputs, double weight) {
+    for(const Entry& entry: m_entries){
+      const DiLeptonSummary& diLepton = outputs.diLeptons_summary[entry.diLepton];
+      if(diLepton.diLepIdx < 0)
+        continue;
+
+      double result;
+      if(value(outputs, entry.variable, entry.combination, result))
+        m_histograms[entry.first_histogram + diLepton.flavour].fill(result, weight);
+    }
+  }
+
+  void HistogramAggregator::merge(const HistogramAggregator& other) {
+    if(other.m_names != m_names)
+      throw std::invalid_argument("Cannot merge differently configured histograms");
+
+    for(size_t i = 0; i < m_histograms.size(); i++)
+      m_histograms[i].merge(other.m_histograms[i]);
+  }
+
+  void HistogramAggregator::write(const std::string& path) const {
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "recreate"));
+    if(!file || file->IsZombie())
+      throw std::runtime_error("Cannot create histograms file " + path);
+
+    for(size_t i = 0; i < m_histograms.size(); i++){
+      const Histogram& histogram = m_histograms[i];
+
+      TH1F output(m_names[i].c_str(), m_names[i].c_str(), histogram.bins(), histogram.min(), histogram.max());
+      output.Sumw2();
+      for(uint32_t bin = 0; bin < histogram.bins() + 2; bin++){
+        output.SetBinContent(bin, histogram.sumw(bin));
+        output.SetBinError(bin, std::sqrt(histogram.sumw2(bin)));
+      }
+      output.SetEntries(histogram.entries());
+      output.Write();
+    }
+
+    file->Close();
+  }
+
+  std::shared_ptr<HistogramsFile> HistogramsFile::open(const std::string& path) {
+
+    std::shared_ptr<HistogramsFile> file = sharedByPath<HistogramsFile>(path);
+
+    std::lock_guard<std::mutex> lock(file->m_mutex);
+    file->m_pending++;
+    return file;
+  }
+
+  bool HistogramsFile::add(const HistogramAggregator& histograms) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_merged)
+      m_merged.reset(new HistogramAggregator(histograms));
+    else
+      m_merged->merge(histograms);
+
+    if(--m_pending > 0)
+      return false;
+
+    m_merged->write(m_path);
+    return true;
+  }
+
+}
@@ -2,131 +2,543 @@
 
 #include <Math/Vector3D.h>
 
+#include <algorithm>
+#include <cmath>
+
+constexpr double NeutrinosSolver::m_epsilon;
+
+// Elimination of E1 between the two conics of solve2Quads (a20 != 0 or b20 != 0): alpha E2^2 + beta E1E2 + gamma E1 + delta E2 + omega = 0,
+// and the quartic in E2 a E2^4 + b E2^3 + c E2^2 + d E2 + e = 0. Also computed by the batch solver, for a block of configurations at once.
+struct QuadsElimination {
+    QuadsElimination(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00, const double b20, const double b02, const double b11, const double b10, const double b01, const double b00):
+        alpha(b20*a02-a20*b02),
+        beta(b20*a11-a20*b11),
+        gamma(b20*a10-a20*b10),
+        delta(b20*a01-a20*b01),
+        omega(b20*a00-a20*b00) {
+
+        a = a20*SQ(alpha) + a02*SQ(beta) - a11*alpha*beta;
+        b = 2.*a20*alpha*delta - a11*( alpha*gamma + delta*beta ) - a10*alpha*beta + 2.*a02*beta*gamma + a01*SQ(beta);
+        c = a20*SQ(delta) + 2.*a20*alpha*omega - a11*( delta*gamma + omega*beta ) - a10*( alpha*gamma + delta*beta )
+            + a02*SQ(gamma) + 2.*a01*beta*gamma + a00*SQ(beta);
+        d = 2.*a20*delta*omega - a11*omega*gamma - a10*( delta*gamma + omega*beta ) + a01*SQ(gamma) + 2.*a00*beta*gamma;
+        e = a20*SQ(omega) - a10*omega*gamma + a00*SQ(gamma);
+    }
+
+    const double alpha, beta, gamma, delta, omega;
+    double a, b, c, d, e;
+};
+
+// E1 for each root E2 of the quartic of the elimination. Roots without any E1 are removed from E2.
+bool solve2QuadsE1(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00, const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+        const double alpha, const double beta, const double gamma, const double delta, const double omega, std::vector<double>& E1, std::vector<double>& E2);
+
 std::vector<std::pair<NeutrinosSolver::LorentzVector, NeutrinosSolver::LorentzVector>> NeutrinosSolver::getNeutrinos(const LorentzVector& lepton1_p4, 
         const LorentzVector& lepton2_p4, 
         const LorentzVector& bjet1_p4, 
         const LorentzVector& bjet2_p4,
-        const LorentzVector& met) {
+        const LorentzVector& met) const {
+
+    Status status;
+    return getNeutrinos(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met, status);
+}
+
+std::vector<std::pair<NeutrinosSolver::LorentzVector, NeutrinosSolver::LorentzVector>> NeutrinosSolver::getNeutrinos(const LorentzVector& lepton1_p4, 
+        const LorentzVector& lepton2_p4, 
+        const LorentzVector& bjet1_p4, 
+        const LorentzVector& bjet2_p4,
+        const LorentzVector& met,
+        Status& status) const {
+
+    const MassHypothesis hypothesis = { t_mass, w_mass };
+
+    std::vector<std::pair<LorentzVector, LorentzVector>> neutrinos;
+    uint32_t offsets[2];
+    solveHypotheses(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met, &hypothesis, 1, neutrinos, offsets, &status);
+
+    return neutrinos;
+}
+
+void NeutrinosSolver::getNeutrinos(const LorentzVector& lepton1_p4, 
+        const LorentzVector& lepton2_p4, 
+        const LorentzVector& bjet1_p4, 
+        const LorentzVector& bjet2_p4,
+        const LorentzVector& met,
+        const std::vector<MassHypothesis>& hypotheses,
+        SolutionTable& table) const {
 
+    table.m_neutrinos.clear();
+    table.m_offsets.resize(hypotheses.size() + 1);
+    table.m_status.resize(hypotheses.size());
 
-    // pT = transverse total momentum of the visible particles
-    // It will be used to reconstruct neutrinos, but we want to take into account the measured ISR (pt_isr = - pt_met - pt_vis),
-    // so we add pt_isr to pt_vis in order to have pt_vis + pt_nu + pt_isr = 0 as it should be.
+    solveHypotheses(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met, hypotheses.data(), hypotheses.size(), table.m_neutrinos, table.m_offsets.data(), table.m_status.data());
+}
 
-    const LorentzVector& p3 = lepton1_p4;
-    const LorentzVector& p4 = bjet1_p4;
-    const LorentzVector& p5 = lepton2_p4;
-    const LorentzVector& p6 = bjet2_p4;
+void NeutrinosSolver::getNeutrinos(const std::vector<Configuration>& batch, SolutionTable& table) const {
 
-    double s13 = w_mass * w_mass;
-    double s134 = t_mass * t_mass;
-    double s25 = w_mass * w_mass;
-    double s256 = t_mass * t_mass;
+    table.m_neutrinos.clear();
+    table.m_offsets.resize(batch.size() + 1);
+    table.m_status.resize(batch.size());
 
-    LorentzVector ISR = -(lepton1_p4 + lepton2_p4 + bjet1_p4 + bjet2_p4 + met);
-    LorentzVector pT = lepton1_p4 + lepton2_p4 + bjet1_p4 + bjet2_p4 + ISR;
+    // Each configuration starts where the previous one ended
+    table.m_offsets[0] = 0;
 
-    const double p34 = p3.Dot(p4);
-    const double p56 = p5.Dot(p6);
-    const double p33 = p3.M2();
-    const double p44 = p4.M2();
-    const double p55 = p5.M2();
-    const double p66 = p6.M2();
+    solveBatch(batch, table);
+}
 
-    // A1 p1x + B1 p1y + C1 = 0, with C1(E1,E2)
-    // A2 p1y + B2 p2y + C2 = 0, with C2(E1,E2)
-    // ==> express p1x and p1y as functions of E1, E2
+NeutrinosSolver::Status NeutrinosSolver::inputStatus(const LorentzVector& lepton1_p4,
+        const LorentzVector& lepton2_p4,
+        const LorentzVector& bjet1_p4,
+        const LorentzVector& bjet2_p4,
+        const LorentzVector& met) const {
 
-    const double A1 = 2.*( -p3.Px() + p3.Pz()*p4.Px()/p4.Pz() );
-    const double A2 = 2.*( p5.Px() - p5.Pz()*p6.Px()/p6.Pz() );
+    auto isFinite = [](const LorentzVector& p) {
+        return std::isfinite(p.Px()) && std::isfinite(p.Py()) && std::isfinite(p.Pz()) && std::isfinite(p.E());
+    };
 
-    const double B1 = 2.*( -p3.Py() + p3.Pz()*p4.Py()/p4.Pz() );
-    const double B2 = 2.*( p5.Py() - p5.Pz()*p6.Py()/p6.Pz() );
+    if (!isFinite(lepton1_p4) || !isFinite(lepton2_p4) || !isFinite(bjet1_p4) || !isFinite(bjet2_p4) || !isFinite(met))
+        return InvalidInput;
+    // We divide by the b-jets Pz
+    if (std::abs(bjet1_p4.Pz()) <= m_epsilon * bjet1_p4.E() || std::abs(bjet2_p4.Pz()) <= m_epsilon * bjet2_p4.E())
+        return BJetPzZero;
 
-    const double Dx = B2*A1 - B1*A2;
-    const double Dy = A2*B1 - A1*B2;
+    return Solved;
+}
 
-    const double X = 2*( pT.Px()*p5.Px() + pT.Py()*p5.Py() - p5.Pz()/p6.Pz()*( 0.5*(s25 - s256 + p66) + p56 + pT.Px()*p6.Px() + pT.Py()*p6.Py() ) ) + p55 - s25;
-    const double Y = p3.Pz()/p4.Pz()*( s13 - s134 + 2*p34 + p44 ) - p33 + s13;
+struct NeutrinosSolver::Kinematics {
 
-    // p1x = alpha1 E1 + beta1 E2 + gamma1
-    // p1y = ...(2)
-    // p1z = ...(3)
-    // p2z = ...(4)
-    // p2x = ...(5)
-    // p2y = ...(6)
 
-    const double alpha1 = -2*B2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dx;
-    const double beta1 = 2*B1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dx;
-    const double gamma1 = B1*X/Dx + B2*Y/Dx;
+    Kinematics(const LorentzVector& lepton1_p4, 
+            const LorentzVector& lepton2_p4, 
+            const LorentzVector& bjet1_p4, 
+            const LorentzVector& bjet2_p4,
+            const LorentzVector& met):
+        p3(lepton1_p4), p4(bjet1_p4), p5(lepton2_p4), p6(bjet2_p4) {
 
-    const double alpha2 = -2*A2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dy;
-    const double beta2 = 2*A1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dy;
-    const double gamma2 = A1*X/Dy + A2*Y/Dy;
+        // pT = transverse total momentum of the visible particles
+        // It will be used to reconstruct neutrinos, but we want to take into account the measured ISR (pt_isr = - pt_met - pt_vis),
+        // so we add pt_isr to pt_vis in order to have pt_vis + pt_nu + pt_isr = 0 as it should be.
 
-    const double alpha3 = (p4.E() - alpha1*p4.Px() - alpha2*p4.Py())/p4.Pz();
-    const double beta3 = -(beta1*p4.Px() + beta2*p4.Py())/p4.Pz();
-    const double gamma3 = ( 0.5*(s13 - s134 + p44) + p34 - gamma1*p4.Px() - gamma2*p4.Py() )/p4.Pz();
+        LorentzVector ISR = -(p3 + p5 + p4 + p6 + met);
+        pT = p3 + p5 + p4 + p6 + ISR;
 
-    const double alpha4 = (alpha1*p6.Px() + alpha2*p6.Py())/p6.Pz();
-    const double beta4 = (p6.E() + beta1*p6.Px() + beta2*p6.Py())/p6.Pz();
-    const double gamma4 = ( 0.5*(s25 - s256 + p66) + p56 + (gamma1 + pT.Px())*p6.Px() + (gamma2 + pT.Py())*p6.Py() )/p6.Pz();
+        p34 = p3.Dot(p4);
+        p56 = p5.Dot(p6);
+        p33 = p3.M2();
+        p44 = p4.M2();
+        p55 = p5.M2();
+        p66 = p6.M2();
 
-    const double alpha5 = -alpha1;
-    const double beta5 = -beta1;
-    const double gamma5 = -pT.Px() - gamma1;
+        // A1 p1x + B1 p1y + C1 = 0, with C1(E1,E2)
+        // A2 p1y + B2 p2y + C2 = 0, with C2(E1,E2)
+        // ==> express p1x and p1y as functions of E1, E2
 
-    const double alpha6 = -alpha2;
-    const double beta6 = -beta2;
-    const double gamma6 = -pT.Py() - gamma2;
+        A1 = 2.*( -p3.Px() + p3.Pz()*p4.Px()/p4.Pz() );
+        A2 = 2.*( p5.Px() - p5.Pz()*p6.Px()/p6.Pz() );
+
+        B1 = 2.*( -p3.Py() + p3.Pz()*p4.Py()/p4.Pz() );
+        B2 = 2.*( p5.Py() - p5.Pz()*p6.Py()/p6.Pz() );
+
+        Dx = B2*A1 - B1*A2;
+        Dy = A2*B1 - A1*B2;
+
+        // We divide by Dx and Dy below
+        const double Dscale = std::abs(B2*A1) + std::abs(B1*A2);
+        degenerate = std::abs(Dx) <= m_epsilon * Dscale;
+        if (degenerate)
+            return;
+
+        // p1x = alpha1 E1 + beta1 E2 + gamma1
+        // p1y = ...(2)
+        // p1z = ...(3)
+        // p2z = ...(4)
+        // p2x = ...(5)
+        // p2y = ...(6)
+        // Only the gammas depend on the masses
+
+        alpha1 = -2*B2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dx;
+        beta1 = 2*B1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dx;
+
+        alpha2 = -2*A2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dy;
+        beta2 = 2*A1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dy;
+
+        alpha3 = (p4.E() - alpha1*p4.Px() - alpha2*p4.Py())/p4.Pz();
+        beta3 = -(beta1*p4.Px() + beta2*p4.Py())/p4.Pz();
 
-    // a11 E1^2 + a22 E2^2 + a12 E1E2 + a10 E1 + a01 E2 + a00 = 0
-    // id. with bij
+        alpha4 = (alpha1*p6.Px() + alpha2*p6.Py())/p6.Pz();
+        beta4 = (p6.E() + beta1*p6.Px() + beta2*p6.Py())/p6.Pz();
+
+        alpha5 = -alpha1;
+        beta5 = -beta1;
+
+        alpha6 = -alpha2;
+        beta6 = -beta2;
+
+        // a11 E1^2 + a22 E2^2 + a12 E1E2 + a10 E1 + a01 E2 + a00 = 0
+        // id. with bij
+        // Only the linear and constant terms depend on the masses
+
+        a11 = -1 + ( SQ(alpha1) + SQ(alpha2) + SQ(alpha3) );
+        a22 = SQ(beta1) + SQ(beta2) + SQ(beta3);
+        a12 = 2.*( alpha1*beta1 + alpha2*beta2 + alpha3*beta3 );
+
+        b11 = SQ(alpha5) + SQ(alpha6) + SQ(alpha4);
+        b22 = -1 + ( SQ(beta5) + SQ(beta6) + SQ(beta4) );
+        b12 = 2.*( alpha5*beta5 + alpha6*beta6 + alpha4*beta4 );
+    }
+
+    const LorentzVector p3, p4, p5, p6;
+    LorentzVector pT;
+
+    double p34, p56, p33, p44, p55, p66;
+    double A1, A2, B1, B2, Dx, Dy;
+    bool degenerate;
+
+    double alpha1, beta1, alpha2, beta2, alpha3, beta3, alpha4, beta4, alpha5, beta5, alpha6, beta6;
+    double a11, a22, a12, b11, b22, b12;
+};
+
+void NeutrinosSolver::solveHypotheses(const LorentzVector& lepton1_p4, 
+        const LorentzVector& lepton2_p4, 
+        const LorentzVector& bjet1_p4, 
+        const LorentzVector& bjet2_p4,
+        const LorentzVector& met,
+        const MassHypothesis* hypotheses,
+        size_t n_hypotheses,
+        std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos,
+        uint32_t* offsets,
+        Status* status) const {
+
+    offsets[0] = neutrinos.size();
+
+    const Status input_status = inputStatus(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met);
+    if (input_status != Solved) {
+        std::fill(status, status + n_hypotheses, input_status);
+        std::fill(offsets + 1, offsets + n_hypotheses + 1, offsets[0]);
+        return;
+    }
+
+    solveAll(Kinematics(lepton1_p4, lepton2_p4, bjet1_p4, bjet2_p4, met), hypotheses, n_hypotheses, neutrinos, offsets, status);
+}
+
+// Kinematic pre-check: with a massless neutrino and on-shell W and top, m_lb^2 - m_l^2 = mt^2 - mW^2 - 2 p_nu.p_b,
+// which cannot exceed mt^2 - mW^2 for a time-like b-jet. Above this endpoint, no intersection of the conics has positive energies.
+bool NeutrinosSolver::aboveMlbEndpoint(const double p34, const double p44, const double p56, const double p66, const MassHypothesis& hypothesis) const {
+
+    const double s13 = hypothesis.w_mass * hypothesis.w_mass;
+    const double s134 = hypothesis.top_mass * hypothesis.top_mass;
+
+    const double endpoint = s134 - s13;
+    const double mlb1 = 2*p34 + p44;
+    const double mlb2 = 2*p56 + p66;
+
+    return (p44 >= 0 && mlb1 > endpoint * (1 + m_epsilon)) || (p66 >= 0 && mlb2 > endpoint * (1 + m_epsilon));
+}
+
+// Solve all the hypotheses with one scalar type
+void NeutrinosSolver::solveAll(const Kinematics& kinematics, const MassHypothesis* hypotheses, size_t n_hypotheses,
+        std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos, uint32_t* offsets, Status* status) const {
+
+    for (size_t h = 0; h < n_hypotheses; h++) {
+        status[h] = kinematics.degenerate ? Degenerate : solve(kinematics, hypotheses[h], neutrinos);
+        offsets[h + 1] = neutrinos.size();
+    }
+}
+
+NeutrinosSolver::Status NeutrinosSolver::solve(const Kinematics& k,
+        const MassHypothesis& hypothesis,
+        std::vector<std::pair<LorentzVector, LorentzVector>>& neutrinos) const {
+
+    const auto& p3 = k.p3;
+    const auto& p4 = k.p4;
+    const auto& p5 = k.p5;
+    const auto& p6 = k.p6;
+    const auto& pT = k.pT;
+
+    const double s13 = hypothesis.w_mass * hypothesis.w_mass;
+    const double s134 = hypothesis.top_mass * hypothesis.top_mass;
+    const double s25 = hypothesis.w_mass * hypothesis.w_mass;
+    const double s256 = hypothesis.top_mass * hypothesis.top_mass;
+
+    if (m_precheck && aboveMlbEndpoint(k.p34, k.p44, k.p56, k.p66, hypothesis))
+        return AboveMlbEndpoint;
+
+    const double X = 2.*( pT.Px()*p5.Px() + pT.Py()*p5.Py() - p5.Pz()/p6.Pz()*( 0.5*(s25 - s256 + k.p66) + k.p56 + pT.Px()*p6.Px() + pT.Py()*p6.Py() ) ) + k.p55 - s25;
+    const double Y = p3.Pz()/p4.Pz()*( s13 - s134 + 2*k.p34 + k.p44 ) - k.p33 + s13;
+
+    const double gamma1 = k.B1*X/k.Dx + k.B2*Y/k.Dx;
+    const double gamma2 = k.A1*X/k.Dy + k.A2*Y/k.Dy;
+    const double gamma3 = ( 0.5*(s13 - s134 + k.p44) + k.p34 - gamma1*p4.Px() - gamma2*p4.Py() )/p4.Pz();
+    const double gamma4 = ( 0.5*(s25 - s256 + k.p66) + k.p56 + (gamma1 + pT.Px())*p6.Px() + (gamma2 + pT.Py())*p6.Py() )/p6.Pz();
+    const double gamma5 = -pT.Px() - gamma1;
+    const double gamma6 = -pT.Py() - gamma2;
 
-    const double a11 = -1 + ( SQ(alpha1) + SQ(alpha2) + SQ(alpha3) );
-    const double a22 = SQ(beta1) + SQ(beta2) + SQ(beta3);
-    const double a12 = 2.*( alpha1*beta1 + alpha2*beta2 + alpha3*beta3 );
-    const double a10 = 2.*( alpha1*gamma1 + alpha2*gamma2 + alpha3*gamma3 );
-    const double a01 = 2.*( beta1*gamma1 + beta2*gamma2 + beta3*gamma3 );
+    const double a10 = 2.*( k.alpha1*gamma1 + k.alpha2*gamma2 + k.alpha3*gamma3 );
+    const double a01 = 2.*( k.beta1*gamma1 + k.beta2*gamma2 + k.beta3*gamma3 );
     const double a00 = SQ(gamma1) + SQ(gamma2) + SQ(gamma3);
 
-    const double b11 = SQ(alpha5) + SQ(alpha6) + SQ(alpha4);
-    const double b22 = -1 + ( SQ(beta5) + SQ(beta6) + SQ(beta4) );
-    const double b12 = 2.*( alpha5*beta5 + alpha6*beta6 + alpha4*beta4 );
-    const double b10 = 2.*( alpha5*gamma5 + alpha6*gamma6 + alpha4*gamma4 );
-    const double b01 = 2.*( beta5*gamma5 + beta6*gamma6 + beta4*gamma4 );
+    const double b10 = 2.*( k.alpha5*gamma5 + k.alpha6*gamma6 + k.alpha4*gamma4 );
+    const double b01 = 2.*( k.beta5*gamma5 + k.beta6*gamma6 + k.beta4*gamma4 );
     const double b00 = SQ(gamma5) + SQ(gamma6) + SQ(gamma4);
 
     // Find the intersection of the 2 conics (at most 4 real solutions for (E1,E2))
     std::vector<double> E1, E2;
-    solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, E2);
+    solve2Quads(k.a11, k.a22, k.a12, a10, a01, a00, k.b11, k.b22, k.b12, b10, b01, b00, E1, E2);
 
-    // For each solution (E1,E2), find the neutrino 4-momenta p1,p2
-    std::vector<std::pair<LorentzVector, LorentzVector>> neutrinos;
+    if (E1.empty())
+        return NoRealSolution;
+
+    const size_t n_neutrinos = neutrinos.size();
 
+    // For each solution (E1,E2), find the neutrino 4-momenta p1,p2
     for (size_t i = 0; i < E1.size(); i++){
         const double e1 = E1.at(i);
         const double e2 = E2.at(i);
 
-        if (e1 < 0. || e2 < 0.)
+        if (e1 < 0 || e2 < 0)
             continue;
 
         LorentzVector p1(
-                alpha1*e1 + beta1*e2 + gamma1,
-                alpha2*e1 + beta2*e2 + gamma2,
-                alpha3*e1 + beta3*e2 + gamma3,
+                k.alpha1*e1 + k.beta1*e2 + gamma1,
+                k.alpha2*e1 + k.beta2*e2 + gamma2,
+                k.alpha3*e1 + k.beta3*e2 + gamma3,
                 e1);
 
         LorentzVector p2(
-                alpha5*e1 + beta5*e2 + gamma5,
-                alpha6*e1 + beta6*e2 + gamma6,
-                alpha4*e1 + beta4*e2 + gamma4,
+                k.alpha5*e1 + k.beta5*e2 + gamma5,
+                k.alpha6*e1 + k.beta6*e2 + gamma6,
+                k.alpha4*e1 + k.beta4*e2 + gamma4,
                 e2);
 
         neutrinos.push_back(std::make_pair(p1, p2));
     }
 
-    return neutrinos;
+    return neutrinos.size() == n_neutrinos ? NoPositiveSolution : Solved;
+}
+
+// Configurations of the batch call solved together, in structure-of-arrays form: inputs, as in Kinematics
+struct NeutrinosSolver::Block {
+    static constexpr size_t N = m_block_size;
+
+    size_t size = 0;
+    size_t index[N]; // Index of each configuration in the batch
+
+    double p3x[N], p3y[N], p3z[N], p3e[N], p4x[N], p4y[N], p4z[N], p4e[N], p5x[N], p5y[N], p5z[N], p5e[N], p6x[N], p6y[N], p6z[N], p6e[N];
+    double pTx[N], pTy[N], p34[N], p56[N], p33[N], p44[N], p55[N], p66[N];
+};
+
+void NeutrinosSolver::solveBatch(const std::vector<Configuration>& batch, SolutionTable& table) const {
+
+    const MassHypothesis hypothesis = { t_mass, w_mass };
+
+    // The configurations failing the checks are not added to the block. The number of solutions of each configuration is stored
+    // in the offsets, and summed at the end.
+    Block block;
+    for (size_t i = 0; i < batch.size(); i++) {
+        const Configuration& c = batch[i];
+        table.m_offsets[i + 1] = 0;
+
+        table.m_status[i] = inputStatus(c.lepton1_p4, c.lepton2_p4, c.bjet1_p4, c.bjet2_p4, c.met);
+        if (table.m_status[i] != Solved)
+            continue;
+
+        const LorentzVector p3(c.lepton1_p4), p4(c.bjet1_p4), p5(c.lepton2_p4), p6(c.bjet2_p4);
+        const double p34 = p3.Dot(p4), p44 = p4.M2(), p56 = p5.Dot(p6), p66 = p6.M2();
+
+        if (m_precheck && aboveMlbEndpoint(p34, p44, p56, p66, hypothesis)) {
+            table.m_status[i] = AboveMlbEndpoint;
+            continue;
+        }
+
+        LorentzVector ISR = -(p3 + p5 + p4 + p6 + c.met);
+        LorentzVector pT = p3 + p5 + p4 + p6 + ISR;
+
+        const size_t k = block.size++;
+        block.index[k] = i;
+        block.p3x[k] = p3.Px(); block.p3y[k] = p3.Py(); block.p3z[k] = p3.Pz(); block.p3e[k] = p3.E();
+        block.p4x[k] = p4.Px(); block.p4y[k] = p4.Py(); block.p4z[k] = p4.Pz(); block.p4e[k] = p4.E();
+        block.p5x[k] = p5.Px(); block.p5y[k] = p5.Py(); block.p5z[k] = p5.Pz(); block.p5e[k] = p5.E();
+        block.p6x[k] = p6.Px(); block.p6y[k] = p6.Py(); block.p6z[k] = p6.Pz(); block.p6e[k] = p6.E();
+        block.pTx[k] = pT.Px(); block.pTy[k] = pT.Py();
+        block.p34[k] = p34;
+        block.p56[k] = p56;
+        block.p33[k] = p3.M2();
+        block.p44[k] = p44;
+        block.p55[k] = p5.M2();
+        block.p66[k] = p66;
+
+        if (block.size == Block::N) {
+            solveBlock(block, hypothesis, table);
+            block.size = 0;
+        }
+    }
+
+    if (block.size) {
+        // Padded with its first configuration, whose results are ignored
+        for (size_t k = block.size; k < Block::N; k++) {
+            block.p3x[k] = block.p3x[0]; block.p3y[k] = block.p3y[0]; block.p3z[k] = block.p3z[0]; block.p3e[k] = block.p3e[0];
+            block.p4x[k] = block.p4x[0]; block.p4y[k] = block.p4y[0]; block.p4z[k] = block.p4z[0]; block.p4e[k] = block.p4e[0];
+            block.p5x[k] = block.p5x[0]; block.p5y[k] = block.p5y[0]; block.p5z[k] = block.p5z[0]; block.p5e[k] = block.p5e[0];
+            block.p6x[k] = block.p6x[0]; block.p6y[k] = block.p6y[0]; block.p6z[k] = block.p6z[0]; block.p6e[k] = block.p6e[0];
+            block.pTx[k] = block.pTx[0]; block.pTy[k] = block.pTy[0];
+            block.p34[k] = block.p34[0]; block.p56[k] = block.p56[0]; block.p33[k] = block.p33[0];
+            block.p44[k] = block.p44[0]; block.p55[k] = block.p55[0]; block.p66[k] = block.p66[0];
+        }
+        solveBlock(block, hypothesis, table);
+    }
+
+    for (size_t i = 0; i < batch.size(); i++)
+        table.m_offsets[i + 1] += table.m_offsets[i];
+}
+
+// Same computation as Kinematics, solveAll and solve, for a full block. Up to the coefficients of the quartic, each step is a loop without
+// branches over the arrays of the block, which the compiler can vectorize. Only the roots are then found one configuration at a time.
+void NeutrinosSolver::solveBlock(const Block& b, const MassHypothesis& hypothesis, SolutionTable& table) const {
+
+    constexpr size_t N = Block::N;
+
+    // Mass-independent part of the system
+    double A1[N], A2[N], B1[N], B2[N], Dx[N], Dy[N], Dscale[N];
+    double alpha1[N], beta1[N], alpha2[N], beta2[N], alpha3[N], beta3[N], alpha4[N], beta4[N], alpha5[N], beta5[N], alpha6[N], beta6[N];
+    double a11[N], a22[N], a12[N], b11[N], b22[N], b12[N];
+
+    for (size_t i = 0; i < N; i++) {
+        A1[i] = 2.*( -b.p3x[i] + b.p3z[i]*b.p4x[i]/b.p4z[i] );
+        A2[i] = 2.*( b.p5x[i] - b.p5z[i]*b.p6x[i]/b.p6z[i] );
+
+        B1[i] = 2.*( -b.p3y[i] + b.p3z[i]*b.p4y[i]/b.p4z[i] );
+        B2[i] = 2.*( b.p5y[i] - b.p5z[i]*b.p6y[i]/b.p6z[i] );
+
+        Dx[i] = B2[i]*A1[i] - B1[i]*A2[i];
+        Dy[i] = A2[i]*B1[i] - A1[i]*B2[i];
+        Dscale[i] = std::abs(B2[i]*A1[i]) + std::abs(B1[i]*A2[i]);
+
+        alpha1[i] = -2*B2[i]*(b.p3e[i] - b.p4e[i]*b.p3z[i]/b.p4z[i])/Dx[i];
+        beta1[i] = 2*B1[i]*(b.p5e[i] - b.p6e[i]*b.p5z[i]/b.p6z[i])/Dx[i];
+
+        alpha2[i] = -2*A2[i]*(b.p3e[i] - b.p4e[i]*b.p3z[i]/b.p4z[i])/Dy[i];
+        beta2[i] = 2*A1[i]*(b.p5e[i] - b.p6e[i]*b.p5z[i]/b.p6z[i])/Dy[i];
+
+        alpha3[i] = (b.p4e[i] - alpha1[i]*b.p4x[i] - alpha2[i]*b.p4y[i])/b.p4z[i];
+        beta3[i] = -(beta1[i]*b.p4x[i] + beta2[i]*b.p4y[i])/b.p4z[i];
+
+        alpha4[i] = (alpha1[i]*b.p6x[i] + alpha2[i]*b.p6y[i])/b.p6z[i];
+        beta4[i] = (b.p6e[i] + beta1[i]*b.p6x[i] + beta2[i]*b.p6y[i])/b.p6z[i];
+
+        alpha5[i] = -alpha1[i];
+        beta5[i] = -beta1[i];
+
+        alpha6[i] = -alpha2[i];
+        beta6[i] = -beta2[i];
+
+        a11[i] = -1 + ( SQ(alpha1[i]) + SQ(alpha2[i]) + SQ(alpha3[i]) );
+        a22[i] = SQ(beta1[i]) + SQ(beta2[i]) + SQ(beta3[i]);
+        a12[i] = 2.*( alpha1[i]*beta1[i] + alpha2[i]*beta2[i] + alpha3[i]*beta3[i] );
+
+        b11[i] = SQ(alpha5[i]) + SQ(alpha6[i]) + SQ(alpha4[i]);
+        b22[i] = -1 + ( SQ(beta5[i]) + SQ(beta6[i]) + SQ(beta4[i]) );
+        b12[i] = 2.*( alpha5[i]*beta5[i] + alpha6[i]*beta6[i] + alpha4[i]*beta4[i] );
+    }
+
+    const double s13 = hypothesis.w_mass * hypothesis.w_mass;
+    const double s134 = hypothesis.top_mass * hypothesis.top_mass;
+    const double s25 = hypothesis.w_mass * hypothesis.w_mass;
+    const double s256 = hypothesis.top_mass * hypothesis.top_mass;
+
+    // Mass-dependent part of the system
+    double gamma1[N], gamma2[N], gamma3[N], gamma4[N], gamma5[N], gamma6[N];
+    double a10[N], a01[N], a00[N], b10[N], b01[N], b00[N];
+
+    for (size_t i = 0; i < N; i++) {
+        const double X = 2.*( b.pTx[i]*b.p5x[i] + b.pTy[i]*b.p5y[i] - b.p5z[i]/b.p6z[i]*( 0.5*(s25 - s256 + b.p66[i]) + b.p56[i] + b.pTx[i]*b.p6x[i] + b.pTy[i]*b.p6y[i] ) ) + b.p55[i] - s25;
+        const double Y = b.p3z[i]/b.p4z[i]*( s13 - s134 + 2*b.p34[i] + b.p44[i] ) - b.p33[i] + s13;
+
+        gamma1[i] = B1[i]*X/Dx[i] + B2[i]*Y/Dx[i];
+        gamma2[i] = A1[i]*X/Dy[i] + A2[i]*Y/Dy[i];
+        gamma3[i] = ( 0.5*(s13 - s134 + b.p44[i]) + b.p34[i] - gamma1[i]*b.p4x[i] - gamma2[i]*b.p4y[i] )/b.p4z[i];
+        gamma4[i] = ( 0.5*(s25 - s256 + b.p66[i]) + b.p56[i] + (gamma1[i] + b.pTx[i])*b.p6x[i] + (gamma2[i] + b.pTy[i])*b.p6y[i] )/b.p6z[i];
+        gamma5[i] = -b.pTx[i] - gamma1[i];
+        gamma6[i] = -b.pTy[i] - gamma2[i];
+
+        a10[i] = 2.*( alpha1[i]*gamma1[i] + alpha2[i]*gamma2[i] + alpha3[i]*gamma3[i] );
+        a01[i] = 2.*( beta1[i]*gamma1[i] + beta2[i]*gamma2[i] + beta3[i]*gamma3[i] );
+        a00[i] = SQ(gamma1[i]) + SQ(gamma2[i]) + SQ(gamma3[i]);
+
+        b10[i] = 2.*( alpha5[i]*gamma5[i] + alpha6[i]*gamma6[i] + alpha4[i]*gamma4[i] );
+        b01[i] = 2.*( beta5[i]*gamma5[i] + beta6[i]*gamma6[i] + beta4[i]*gamma4[i] );
+        b00[i] = SQ(gamma5[i]) + SQ(gamma6[i]) + SQ(gamma4[i]);
+    }
+
+    // Quartic of the intersection of the conics, as in solve2Quads
+    double e_alpha[N], e_beta[N], e_gamma[N], e_delta[N], e_omega[N], qa[N], qb[N], qc[N], qd[N], qe[N];
+
+    for (size_t i = 0; i < N; i++) {
+        const QuadsElimination elimination(a11[i], a22[i], a12[i], a10[i], a01[i], a00[i], b11[i], b22[i], b12[i], b10[i], b01[i], b00[i]);
+        e_alpha[i] = elimination.alpha;
+        e_beta[i] = elimination.beta;
+        e_gamma[i] = elimination.gamma;
+        e_delta[i] = elimination.delta;
+        e_omega[i] = elimination.omega;
+        qa[i] = elimination.a;
+        qb[i] = elimination.b;
+        qc[i] = elimination.c;
+        qd[i] = elimination.d;
+        qe[i] = elimination.e;
+    }
+
+    // Roots and neutrinos, one configuration at a time
+    std::vector<double> E1, E2;
+    for (size_t i = 0; i < b.size; i++) {
+        Status& status = table.m_status[b.index[i]];
+
+        if (std::abs(Dx[i]) <= m_epsilon * Dscale[i]) {
+            status = Degenerate;
+            continue;
+        }
+
+        E1.clear();
+        E2.clear();
+        if (a11[i] == 0 && b11[i] == 0) {
+            // No E1^2 term: solve2Quads swaps E1 and E2, or solves a degenerate system
+            solve2Quads(a11[i], a22[i], a12[i], a10[i], a01[i], a00[i], b11[i], b22[i], b12[i], b10[i], b01[i], b00[i], E1, E2);
+        } else {
+            solveQuartic(qa[i], qb[i], qc[i], qd[i], qe[i], E2);
+            solve2QuadsE1(a11[i], a22[i], a12[i], a10[i], a01[i], a00[i], b11[i], b22[i], b12[i], b10[i], b01[i], b00[i],
+                    e_alpha[i], e_beta[i], e_gamma[i], e_delta[i], e_omega[i], E1, E2);
+        }
+
+        if (E1.empty()) {
+            status = NoRealSolution;
+            continue;
+        }
+
+        const size_t n_neutrinos = table.m_neutrinos.size();
+
+        for (size_t j = 0; j < E1.size(); j++) {
+            const double e1 = E1[j];
+            const double e2 = E2[j];
+
+            if (e1 < 0 || e2 < 0)
+                continue;
+
+            LorentzVector p1(
+                    alpha1[i]*e1 + beta1[i]*e2 + gamma1[i],
+                    alpha2[i]*e1 + beta2[i]*e2 + gamma2[i],
+                    alpha3[i]*e1 + beta3[i]*e2 + gamma3[i],
+                    e1);
+
+            LorentzVector p2(
+                    alpha5[i]*e1 + beta5[i]*e2 + gamma5[i],
+                    alpha6[i]*e1 + beta6[i]*e2 + gamma6[i],
+                    alpha4[i]*e1 + beta4[i]*e2 + gamma4[i],
+                    e2);
+
+            table.m_neutrinos.push_back(std::make_pair(p1, p2));
+        }
+
+        status = table.m_neutrinos.size() == n_neutrinos ? NoPositiveSolution : Solved;
+        table.m_offsets[b.index[i] + 1] = table.m_neutrinos.size() - n_neutrinos;
+    }
 }
 
 bool solveQuadratic(const double a, const double b, const double c, std::vector<double>& roots) {
@@ -256,20 +668,16 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
 
     }
 
-    const double alpha = b20*a02-a20*b02;
-    const double beta = b20*a11-a20*b11;
-    const double gamma = b20*a10-a20*b10;
-    const double delta = b20*a01-a20*b01;
-    const double omega = b20*a00-a20*b00;
+    const QuadsElimination elimination(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00);
 
-    const double a = a20*SQ(alpha) + a02*SQ(beta) - a11*alpha*beta;
-    const double b = 2.*a20*alpha*delta - a11*( alpha*gamma + delta*beta ) - a10*alpha*beta + 2.*a02*beta*gamma + a01*SQ(beta);
-    const double c = a20*SQ(delta) + 2.*a20*alpha*omega - a11*( delta*gamma + omega*beta ) - a10*( alpha*gamma + delta*beta )
-        + a02*SQ(gamma) + 2.*a01*beta*gamma + a00*SQ(beta);
-    const double d = 2.*a20*delta*omega - a11*omega*gamma - a10*( delta*gamma + omega*beta ) + a01*SQ(gamma) + 2.*a00*beta*gamma;
-    const double e = a20*SQ(omega) - a10*omega*gamma + a00*SQ(gamma);
+    solveQuartic(elimination.a, elimination.b, elimination.c, elimination.d, elimination.e, E2);
+
+    return solve2QuadsE1(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00,
+            elimination.alpha, elimination.beta, elimination.gamma, elimination.delta, elimination.omega, E1, E2);
+}
 
-    solveQuartic(a, b, c, d, e, E2);
+bool solve2QuadsE1(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00, const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+        const double alpha, const double beta, const double gamma, const double delta, const double omega, std::vector<double>& E1, std::vector<double>& E2){
 
     for(unsigned short i = 0; i < E2.size(); ++i){
 
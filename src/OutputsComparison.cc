@@ -0,0 +1,353 @@
+#include <cp3_llbb/TTAnalysis/interface/OutputsComparison.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+namespace TTAnalysis {
+
+  namespace {
+
+    // Walks two outputs of the same type, and records where they differ.
+    // The path of the current field is only formatted when a difference is found.
+    class Comparator {
+      public:
+        Comparator(double tolerance, size_t max_examples, const std::string& prefix, std::vector<std::string>& examples):
+          m_tolerance(tolerance), m_max_examples(max_examples), m_prefix(prefix), m_examples(examples) {}
+
+        uint64_t differences() const {
+          return m_differences;
+        }
+
+        template<typename T>
+        void field(const char* name, const T& a, const T& b) {
+          m_path.push_back(Step{ name, 0 });
+          compare(a, b);
+          m_path.pop_back();
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value>::type compare(const T& a, const T& b) {
+          if(a != b)
+            difference(+a, +b);
+        }
+
+        void compare(const float& a, const float& b) {
+          if(!close(a, b))
+            difference(a, b);
+        }
+
+        void compare(const myLorentzVector& a, const myLorentzVector& b) {
+          field("Pt", a.Pt(), b.Pt());
+          field("Eta", a.Eta(), b.Eta());
+          // Phi is compared as an angle: -pi and pi are the same
+          if(!close(std::remainder(double(a.Phi()) - b.Phi(), 2 * M_PI), 0)){
+            m_path.push_back(Step{ "Phi", 0 });
+            difference(a.Phi(), b.Phi());
+            m_path.pop_back();
+          }
+          field("E", a.E(), b.E());
+        }
+
+        template<typename T, size_t N>
+        void compare(const T (&a)[N], const T (&b)[N]) {
+          for(size_t i = 0; i < N; i++)
+            item(i, a[i], b[i]);
+        }
+
+        template<typename T>
+        void compare(const IndexPair<T>& a, const IndexPair<T>& b) {
+          field("first", a.first, b.first);
+          field("second", a.second, b.second);
+        }
+
+        template<typename T>
+        void compare(const std::vector<T>& a, const std::vector<T>& b) {
+          if(!sameSize(a.size(), b.size()))
+            return;
+          for(size_t i = 0; i < a.size(); i++)
+            item(i, a[i], b[i]);
+        }
+
+        void compare(const GenParticle& a, const GenParticle& b) {
+          field("p4", a.p4, b.p4);
+          field("pdg_id", a.pdg_id, b.pdg_id);
+        }
+
+        void compare(const Lepton& a, const Lepton& b) {
+          field("p4", a.p4, b.p4);
+          field("idx", a.idx, b.idx);
+          field("charge", a.charge, b.charge);
+          field("isoValue", a.isoValue, b.isoValue);
+          field("hlt_idx", a.hlt_idx, b.hlt_idx);
+          field("isEl", a.isEl, b.isEl);
+          field("isMu", a.isMu, b.isMu);
+          field("ID", a.ID, b.ID);
+          field("iso", a.iso, b.iso);
+          if(a.hlt_idx >= 0){
+            field("hlt_DR_matched_object", a.hlt_DR_matched_object, b.hlt_DR_matched_object);
+            field("hlt_DPt_matched_object", a.hlt_DPt_matched_object, b.hlt_DPt_matched_object);
+          }
+        }
+
+        void compare(const DiLepton& a, const DiLepton& b) {
+          field("p4", a.p4, b.p4);
+          field("idxs", a.idxs, b.idxs);
+          field("lidxs", a.lidxs, b.lidxs);
+          field("hlt_idxs", a.hlt_idxs, b.hlt_idxs);
+          field("isElEl", a.isElEl, b.isElEl);
+          field("isElMu", a.isElMu, b.isElMu);
+          field("isMuEl", a.isMuEl, b.isMuEl);
+          field("isMuMu", a.isMuMu, b.isMuMu);
+          field("isOS", a.isOS, b.isOS);
+          field("isSF", a.isSF, b.isSF);
+          field("ID", a.ID, b.ID);
+          field("iso", a.iso, b.iso);
+          field("DR", a.DR, b.DR);
+          field("DEta", a.DEta, b.DEta);
+          field("DPhi", a.DPhi, b.DPhi);
+        }
+
+        void compare(const Jet& a, const Jet& b) {
+          field("p4", a.p4, b.p4);
+          field("idx", a.idx, b.idx);
+          field("ID", a.ID, b.ID);
+          field("minDRjl_lepIDIso", a.minDRjl_lepIDIso, b.minDRjl_lepIDIso);
+          field("CSVv2", a.CSVv2, b.CSVv2);
+          field("BWP", a.BWP, b.BWP);
+        }
+
+        void compare(const DiJet& a, const DiJet& b) {
+          field("p4", a.p4, b.p4);
+          field("idxs", a.idxs, b.idxs);
+          field("jidxs", a.jidxs, b.jidxs);
+          field("minDRjl_lepIDIso", a.minDRjl_lepIDIso, b.minDRjl_lepIDIso);
+          field("BWP", a.BWP, b.BWP);
+          field("DR", a.DR, b.DR);
+          field("DEta", a.DEta, b.DEta);
+          field("DPhi", a.DPhi, b.DPhi);
+        }
+
+        void compare(const DiLepDiJet& a, const DiLepDiJet& b) {
+          field("p4", a.p4, b.p4);
+          field("diLepIdx", a.diLepIdx, b.diLepIdx);
+          field("diJetIdx", a.diJetIdx, b.diJetIdx);
+          field("DR_ll_jj", a.DR_ll_jj, b.DR_ll_jj);
+          field("DEta_ll_jj", a.DEta_ll_jj, b.DEta_ll_jj);
+          field("DPhi_ll_jj", a.DPhi_ll_jj, b.DPhi_ll_jj);
+          field("minDRjl", a.minDRjl, b.minDRjl);
+          field("maxDRjl", a.maxDRjl, b.maxDRjl);
+          field("minDEtajl", a.minDEtajl, b.minDEtajl);
+          field("maxDEtajl", a.maxDEtajl, b.maxDEtajl);
+          field("minDPhijl", a.minDPhijl, b.minDPhijl);
+          field("maxDPhijl", a.maxDPhijl, b.maxDPhijl);
+        }
+
+        void compare(const DiLepDiJetMet& a, const DiLepDiJetMet& b) {
+          compare(static_cast<const DiLepDiJet&>(a), static_cast<const DiLepDiJet&>(b));
+          field("diLepDiJetIdx", a.diLepDiJetIdx, b.diLepDiJetIdx);
+          field("hasNoHFMet", a.hasNoHFMet, b.hasNoHFMet);
+          field("DR_ll_Met", a.DR_ll_Met, b.DR_ll_Met);
+          field("DR_jj_Met", a.DR_jj_Met, b.DR_jj_Met);
+          field("DEta_ll_Met", a.DEta_ll_Met, b.DEta_ll_Met);
+          field("DEta_jj_Met", a.DEta_jj_Met, b.DEta_jj_Met);
+          field("DPhi_ll_Met", a.DPhi_ll_Met, b.DPhi_ll_Met);
+          field("DPhi_jj_Met", a.DPhi_jj_Met, b.DPhi_jj_Met);
+          field("DR_lljj_Met", a.DR_lljj_Met, b.DR_lljj_Met);
+          field("DEta_lljj_Met", a.DEta_lljj_Met, b.DEta_lljj_Met);
+          field("DPhi_lljj_Met", a.DPhi_lljj_Met, b.DPhi_lljj_Met);
+          field("minDR_l_Met", a.minDR_l_Met, b.minDR_l_Met);
+          field("minDR_j_Met", a.minDR_j_Met, b.minDR_j_Met);
+          field("maxDR_l_Met", a.maxDR_l_Met, b.maxDR_l_Met);
+          field("maxDR_j_Met", a.maxDR_j_Met, b.maxDR_j_Met);
+          field("minDEta_l_Met", a.minDEta_l_Met, b.minDEta_l_Met);
+          field("minDEta_j_Met", a.minDEta_j_Met, b.minDEta_j_Met);
+          field("maxDEta_l_Met", a.maxDEta_l_Met, b.maxDEta_l_Met);
+          field("maxDEta_j_Met", a.maxDEta_j_Met, b.maxDEta_j_Met);
+          field("minDPhi_l_Met", a.minDPhi_l_Met, b.minDPhi_l_Met);
+          field("minDPhi_j_Met", a.minDPhi_j_Met, b.minDPhi_j_Met);
+          field("maxDPhi_l_Met", a.maxDPhi_l_Met, b.maxDPhi_l_Met);
+          field("maxDPhi_j_Met", a.maxDPhi_j_Met, b.maxDPhi_j_Met);
+        }
+
+        void compare(const TTBar& a, const TTBar& b) {
+          field("p4", a.p4, b.p4);
+          field("diLepDiJetIdx", a.diLepDiJetIdx, b.diLepDiJetIdx);
+          field("top1_p4", a.top1_p4, b.top1_p4);
+          field("top2_p4", a.top2_p4, b.top2_p4);
+          field("DR_tt", a.DR_tt, b.DR_tt);
+          field("DEta_tt", a.DEta_tt, b.DEta_tt);
+          field("DPhi_tt", a.DPhi_tt, b.DPhi_tt);
+        }
+
+        void compare(const TTBarCompact& a, const TTBarCompact& b) {
+          field("diLepDiJetIdx", a.diLepDiJetIdx, b.diLepDiJetIdx);
+          field("top1_p4", a.top1_p4, b.top1_p4);
+          field("top2_p4", a.top2_p4, b.top2_p4);
+        }
+
+        void compare(const TTBarSmeared& a, const TTBarSmeared& b) {
+          field("diLepDiJetIdx", a.diLepDiJetIdx, b.diLepDiJetIdx);
+          field("solvedSamples", a.solvedSamples, b.solvedSamples);
+          field("weight", a.weight, b.weight);
+          field("mtt", a.mtt, b.mtt);
+          field("mttRMS", a.mttRMS, b.mttRMS);
+        }
+
+        // Solutions of one ttbar candidate: sorted by mtt, but solutions with (almost) the same mtt can be swapped.
+        // Each reference solution is compared to the closest remaining candidate solution.
+        void compare(const std::vector<TTBar>& a, const std::vector<TTBar>& b) {
+          compareSolutions(a, b);
+        }
+
+        void compare(const std::vector<TTBarCompact>& a, const std::vector<TTBarCompact>& b) {
+          compareSolutions(a, b);
+        }
+
+        void compare(const Telemetry& a, const Telemetry& b) {
+#define TT_TELEMETRY(NAME, TYPE) field(#NAME, a.NAME, b.NAME);
+#include <cp3_llbb/TTAnalysis/interface/TelemetryList.h>
+#undef TT_TELEMETRY
+        }
+
+      private:
+        struct Step {
+          const char* name; // nullptr for an array index
+          size_t index;
+        };
+
+        const double m_tolerance;
+        const size_t m_max_examples;
+        const std::string& m_prefix;
+        std::vector<std::string>& m_examples;
+
+        std::vector<Step> m_path;
+        uint64_t m_differences = 0;
+
+        bool close(double a, double b) const {
+          if(a == b || (std::isnan(a) && std::isnan(b)))
+            return true;
+          return std::abs(a - b) <= m_tolerance * std::max({ 1., std::abs(a), std::abs(b) });
+        }
+
+        template<typename T>
+        void item(size_t index, const T& a, const T& b) {
+          m_path.push_back(Step{ nullptr, index });
+          compare(a, b);
+          m_path.pop_back();
+        }
+
+        bool sameSize(size_t a, size_t b) {
+          if(a == b)
+            return true;
+          m_path.push_back(Step{ "size()", 0 });
+          difference(a, b);
+          m_path.pop_back();
+          return false;
+        }
+
+        static double mtt(const TTBar& ttbar) {
+          return ttbar.p4.M();
+        }
+
+        static double mtt(const TTBarCompact& ttbar) {
+          return (ttbar.top1_p4 + ttbar.top2_p4).M();
+        }
+
+        template<typename T>
+        void compareSolutions(const std::vector<T>& a, const std::vector<T>& b) {
+          if(!sameSize(a.size(), b.size()))
+            return;
+
+          std::vector<bool> used(b.size(), false);
+          for(size_t i = 0; i < a.size(); i++){
+            size_t closest = 0;
+            double closest_distance = std::numeric_limits<double>::infinity();
+            for(size_t j = 0; j < b.size(); j++){
+              const double distance = std::abs(mtt(a[i]) - mtt(b[j])) + std::abs(a[i].top1_p4.Pt() - b[j].top1_p4.Pt());
+              if(!used[j] && !(distance >= closest_distance)){
+                closest = j;
+                closest_distance = distance;
+              }
+            }
+            used[closest] = true;
+            item(i, a[i], b[closest]);
+          }
+        }
+
+        template<typename T>
+        void difference(const T& a, const T& b) {
+          m_differences++;
+          if(m_examples.size() >= m_max_examples)
+            return;
+
+          std::ostringstream example;
+          example << m_prefix;
+          for(const Step& step: m_path){
+            if(step.name)
+              example << (&step == &m_path.front() ? "" : ".") << step.name;
+            else
+              example << "[" << step.index << "]";
+          }
+          example << ": " << a << " vs " << b;
+          m_examples.push_back(example.str());
+        }
+    };
+
+  }
+
+  OutputsComparison::OutputsComparison(double tolerance, size_t examples):
+    m_tolerance(tolerance), m_max_examples(examples) {
+
+#define TT_OUTPUT(NAME, ...) m_names.push_back(#NAME);
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    m_output_events.resize(m_names.size());
+    m_output_differences.resize(m_names.size());
+    m_examples.resize(m_names.size());
+  }
+
+  uint64_t OutputsComparison::compare(uint32_t run, uint32_t lumi, uint64_t event, const EventOutputs& reference, const EventOutputs& candidate) {
+
+    const std::string prefix = std::to_string(run) + ":" + std::to_string(lumi) + ":" + std::to_string(event) + " ";
+    uint64_t differences = 0;
+
+    size_t index = 0;
+#define TT_OUTPUT(NAME, ...) { \
+      Comparator comparator(m_tolerance, m_max_examples, prefix, m_examples[index]); \
+      comparator.field(#NAME, reference.NAME, candidate.NAME); \
+      if(comparator.differences()){ \
+        m_output_events[index]++; \
+        m_output_differences[index] += comparator.differences(); \
+        differences += comparator.differences(); \
+      } \
+      index++; \
+    }
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    m_events++;
+    if(differences)
+      m_differing_events++;
+
+    return differences;
+  }
+
+  void OutputsComparison::report(std::ostream& out) const {
+
+    out << m_differing_events << " of " << m_events << " events differ (relative tolerance " << m_tolerance << ")" << std::endl;
+
+    for(size_t i = 0; i < m_names.size(); i++){
+      if(!m_output_events[i])
+        continue;
+
+      out << "\t" << m_names[i] << ": " << m_output_events[i] << " events, " << m_output_differences[i] << " fields" << std::endl;
+      for(const std::string& example: m_examples[i])
+        out << "\t\t" << example << std::endl;
+    }
+  }
+
+}
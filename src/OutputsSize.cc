@@ -0,0 +1,122 @@
+#include <cp3_llbb/TTAnalysis/interface/OutputsSize.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace TTAnalysis {
+
+  namespace {
+
+    // Number of objects and bytes of one output: nested arrays are counted down to their innermost elements.
+    // The outputs are cleared but not freed between events: the bytes are those of the capacity of the arrays.
+
+    template<typename T>
+    struct Size {
+      static void add(const T&, uint64_t& objects, uint64_t& bytes) {
+        objects++;
+        bytes += sizeof(T);
+      }
+    };
+
+    template<typename T>
+    struct Size<std::vector<T>> {
+      static void add(const std::vector<T>& array, uint64_t& objects, uint64_t& bytes) {
+        objects += array.size();
+        bytes += sizeof(array) + array.capacity() * sizeof(T);
+      }
+    };
+
+    // The spare capacity of an array of arrays holds no inner array
+    template<typename T>
+    struct Size<std::vector<std::vector<T>>> {
+      static void add(const std::vector<std::vector<T>>& array, uint64_t& objects, uint64_t& bytes) {
+        bytes += sizeof(array) + (array.capacity() - array.size()) * sizeof(std::vector<T>);
+        for(const std::vector<T>& item: array)
+          Size<std::vector<T>>::add(item, objects, bytes);
+      }
+    };
+
+    template<typename T>
+    void addSize(const T& output, uint64_t& objects, uint64_t& bytes) {
+      Size<T>::add(output, objects, bytes);
+    }
+
+    bool largerEvent(const OutputsSizeMonitor::Event& a, const OutputsSizeMonitor::Event& b) {
+      return a.bytes > b.bytes;
+    }
+
+  }
+
+  OutputsSizeMonitor::OutputsSizeMonitor(size_t worstEvents):
+    m_worstEvents(worstEvents) {
+
+#define TT_OUTPUT(NAME, ...) m_names.push_back(#NAME);
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    m_objects.resize(m_names.size());
+    m_bytes.resize(m_names.size());
+    m_max_objects.resize(m_names.size());
+    m_max_bytes.resize(m_names.size());
+  }
+
+  void OutputsSizeMonitor::measure(uint32_t run, uint32_t lumi, uint64_t event, const EventOutputs& outputs) {
+
+    std::fill(m_objects.begin(), m_objects.end(), 0);
+    std::fill(m_bytes.begin(), m_bytes.end(), 0);
+
+    size_t index = 0;
+#define TT_OUTPUT(NAME, ...) addSize(outputs.NAME, m_objects[index], m_bytes[index]); index++;
+#include <cp3_llbb/TTAnalysis/interface/EventOutputsList.h>
+#undef TT_OUTPUT
+
+    Event result = { run, lumi, event, 0, 0, 0 };
+    for(size_t i = 0; i < m_names.size(); i++){
+      m_max_objects[i] = std::max(m_max_objects[i], m_objects[i]);
+      m_max_bytes[i] = std::max(m_max_bytes[i], m_bytes[i]);
+
+      result.bytes += m_bytes[i];
+      if(m_bytes[i] > result.largest_collection_bytes){
+        result.largest_collection = i;
+        result.largest_collection_bytes = m_bytes[i];
+      }
+    }
+
+    m_events++;
+    m_total_bytes += result.bytes;
+
+    if(!m_worstEvents)
+      return;
+
+    if(m_worst.size() < m_worstEvents){
+      m_worst.push_back(result);
+      std::push_heap(m_worst.begin(), m_worst.end(), largerEvent);
+    } else if(result.bytes > m_worst.front().bytes){
+      std::pop_heap(m_worst.begin(), m_worst.end(), largerEvent);
+      m_worst.back() = result;
+      std::push_heap(m_worst.begin(), m_worst.end(), largerEvent);
+    }
+  }
+
+  void OutputsSizeMonitor::report(std::ostream& out, size_t collections) const {
+
+    out << "Outputs size (" << m_events << " events, " << (m_events ? m_total_bytes / m_events : 0) << " bytes per event on average)" << std::endl;
+
+    std::vector<size_t> order(m_names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return m_max_bytes[a] > m_max_bytes[b]; });
+
+    out << "\tLargest collections (high-water mark):" << std::endl;
+    for(size_t i = 0; i < std::min(collections, order.size()); i++)
+      out << "\t\t" << m_names[order[i]] << ": " << m_max_objects[order[i]] << " objects, " << m_max_bytes[order[i]] << " bytes" << std::endl;
+
+    std::vector<Event> worst(m_worst);
+    std::sort(worst.begin(), worst.end(), largerEvent);
+
+    out << "\tLargest events:" << std::endl;
+    for(const Event& event: worst)
+      out << "\t\t" << event.run << ":" << event.lumi << ":" << event.event << ": " << event.bytes << " bytes, of which "
+        << m_names[event.largest_collection] << ": " << event.largest_collection_bytes << " bytes" << std::endl;
+  }
+
+}
@@ -0,0 +1,96 @@
+#include <cp3_llbb/TTAnalysis/interface/TTBarSmearing.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace TTAnalysis {
+
+  TTBarSmearing::TTBarSmearing(const Settings& settings): m_settings(settings) {
+    if (settings.samples == 0 || settings.samples > std::numeric_limits<uint16_t>::max())
+      throw std::invalid_argument("TTBarSmearing: the number of samples must be between 1 and 65535");
+  }
+
+  TTBarSmeared TTBarSmearing::reconstruct(const NeutrinosSolver& solver, uint16_t diLepDiJetIdx, uint64_t seed,
+      const NeutrinosSolver::LorentzVector& lepton1_p4, const NeutrinosSolver::LorentzVector& lepton2_p4,
+      const NeutrinosSolver::LorentzVector& bjet1_p4, const NeutrinosSolver::LorentzVector& bjet2_p4,
+      const NeutrinosSolver::LorentzVector& met_p4) {
+
+    RandomStream random(seed);
+
+    // Energy scale factor, kept positive
+    auto scale = [&random](float resolution) {
+      return std::max(1 + resolution * random.gaussian(), 0.01);
+    };
+
+    m_batch.clear();
+    m_batch_sample.clear();
+    m_rejected = 0;
+
+    // Draw all the samples first (the same numbers whether they are solved or not), and batch both b-jet assignments of each
+    for (uint32_t sample = 0; sample < m_settings.samples; sample++) {
+      NeutrinosSolver::Configuration c;
+      c.lepton1_p4 = lepton1_p4 * scale(m_settings.leptonResolution);
+      c.lepton2_p4 = lepton2_p4 * scale(m_settings.leptonResolution);
+      c.bjet1_p4 = bjet1_p4 * scale(m_settings.jetResolution);
+      c.bjet2_p4 = bjet2_p4 * scale(m_settings.jetResolution);
+
+      // The MET balances the change of the visible momenta
+      const NeutrinosSolver::LorentzVector visible_shift = (c.lepton1_p4 - lepton1_p4) + (c.lepton2_p4 - lepton2_p4) + (c.bjet1_p4 - bjet1_p4) + (c.bjet2_p4 - bjet2_p4);
+      const double met_x = met_p4.Px() - visible_shift.Px() + m_settings.metResolution * random.gaussian();
+      const double met_y = met_p4.Py() - visible_shift.Py() + m_settings.metResolution * random.gaussian();
+      c.met.SetPxPyPzE(met_x, met_y, 0, std::hypot(met_x, met_y));
+
+      for (int swapped = 0; swapped < 2; swapped++) {
+        if (swapped)
+          std::swap(c.bjet1_p4, c.bjet2_p4);
+
+        m_batch.push_back(c);
+        m_batch_sample.push_back(sample);
+      }
+    }
+
+    solver.getNeutrinos(m_batch, m_table);
+    for (size_t i = 0; i < m_table.size(); i++) {
+      if (m_table.status(i) == NeutrinosSolver::AboveMlbEndpoint)
+        m_rejected++;
+    }
+
+    m_sample_mtt.assign(m_settings.samples, 0);
+    for (size_t i = 0; i < m_batch.size(); i++) {
+      const NeutrinosSolver::Configuration& c = m_batch[i];
+      float& sample_mtt = m_sample_mtt[m_batch_sample[i]];
+
+      for (size_t s = 0; s < m_table.solutions(i); s++) {
+        const auto& neutrinos = m_table.solution(i, s);
+        const float mtt = (c.lepton1_p4 + c.bjet1_p4 + neutrinos.first + c.lepton2_p4 + c.bjet2_p4 + neutrinos.second).M();
+        if (sample_mtt == 0 || mtt < sample_mtt)
+          sample_mtt = mtt;
+      }
+    }
+
+    TTBarSmeared result;
+    result.diLepDiJetIdx = diLepDiJetIdx;
+
+    double sum = 0, sum2 = 0;
+    for (const float& mtt: m_sample_mtt) {
+      if (mtt == 0)
+        continue;
+      result.solvedSamples++;
+      sum += mtt;
+      sum2 += double(mtt) * mtt;
+    }
+
+    if (result.solvedSamples) {
+      const double mean = sum / result.solvedSamples;
+      result.weight = float(result.solvedSamples) / m_settings.samples;
+      result.mtt = mean;
+      result.mttRMS = std::sqrt(std::max(sum2 / result.solvedSamples - mean * mean, 0.));
+    }
+
+    return result;
+  }
+
+}
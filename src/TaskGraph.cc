@@ -0,0 +1,191 @@
+#include <cp3_llbb/TTAnalysis/interface/TaskGraph.h>
+
+#include <stdexcept>
+
+namespace TTAnalysis {
+
+  namespace {
+    // Pool and queue of the worker running on this thread, if any
+    thread_local const TaskPool* t_pool = nullptr;
+    thread_local size_t t_queue = 0;
+  }
+
+  TaskPool::TaskPool(size_t threads) {
+    for (size_t i = 0; i <= threads; i++)
+      m_queues.emplace_back(new Queue());
+
+    for (size_t i = 0; i < threads; i++)
+      m_workers.emplace_back(&TaskPool::work, this, i);
+  }
+
+  TaskPool::~TaskPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker: m_workers)
+      worker.join();
+  }
+
+  size_t TaskPool::currentQueue() const {
+    return t_pool == this ? t_queue : m_queues.size() - 1;
+  }
+
+  void TaskPool::submit(Job job) {
+
+    // Counted before being queued, so that a thread checking m_queued under the lock cannot miss it
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_queued++;
+    }
+
+    Queue& queue = *m_queues[currentQueue()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+
+    m_wake.notify_one();
+  }
+
+  bool TaskPool::pop(size_t own, Job& job) {
+
+    // Own queue first (newest job), then steal from the next ones (oldest job)
+    const size_t n = m_queues.size();
+    for (size_t i = 0; i < n; i++) {
+      Queue& queue = *m_queues[(own + i) % n];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.jobs.empty())
+        continue;
+
+      if (i == 0) {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+      } else {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+      }
+      m_queued--;
+      return true;
+    }
+
+    return false;
+  }
+
+  void TaskPool::work(size_t queue) {
+
+    t_pool = this;
+    t_queue = queue;
+
+    Job job;
+    while (true) {
+      if (pop(queue, job)) {
+        job();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+      if (m_stop)
+        return;
+    }
+  }
+
+  void TaskPool::runUntil(const std::function<bool()>& done) {
+
+    const size_t queue = currentQueue();
+
+    Job job;
+    while (!done()) {
+      if (pop(queue, job)) {
+        job();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      m_wake.wait(lock, [this, &done] { return m_queued > 0 || done(); });
+    }
+  }
+
+  void TaskPool::notify() {
+    // Taking the lock orders the notification after the check of any thread about to wait
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_wake.notify_all();
+  }
+
+  TaskGraph::Stage TaskGraph::add(std::function<void()> function, std::initializer_list<Stage> dependencies) {
+
+    const Stage stage = m_nodes.size();
+    for (const Stage& dependency: dependencies) {
+      if (dependency >= stage)
+        throw std::invalid_argument("TaskGraph: a stage can only depend on the stages added before it");
+      m_nodes[dependency].dependents.push_back(stage);
+    }
+
+    m_nodes.push_back({std::move(function), {}, dependencies.size()});
+    m_pending = std::vector<std::atomic<size_t>>(m_nodes.size());
+
+    return stage;
+  }
+
+  void TaskGraph::run(TaskPool* pool) {
+
+    if (!pool || !pool->threads()) {
+      for (Node& node: m_nodes)
+        node.function();
+      return;
+    }
+
+    m_pool = pool;
+    m_remaining = m_nodes.size();
+    m_failed = false;
+    m_error = nullptr;
+    for (Stage stage = 0; stage < m_nodes.size(); stage++)
+      m_pending[stage] = m_nodes[stage].dependencies;
+
+    for (Stage stage = 0; stage < m_nodes.size(); stage++) {
+      if (!m_nodes[stage].dependencies)
+        submit(stage);
+    }
+
+    pool->runUntil([this] { return m_remaining == 0; });
+
+    if (m_error)
+      std::rethrow_exception(m_error);
+  }
+
+  void TaskGraph::submit(Stage stage) {
+    m_pool->submit([this, stage] { execute(stage); });
+  }
+
+  void TaskGraph::execute(Stage stage) {
+
+    const Node& node = m_nodes[stage];
+    TaskPool* pool = m_pool; // The graph may be gone once m_remaining reaches 0
+
+    if (!m_failed) {
+      try {
+        node.function();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_error_mutex);
+        if (!m_error)
+          m_error = std::current_exception();
+        m_failed = true;
+      }
+    }
+
+    // The atomic counters order everything written by this stage before its dependents, and before the end of run()
+    for (const Stage& dependent: node.dependents) {
+      if (--m_pending[dependent] == 0)
+        submit(dependent);
+    }
+
+    if (--m_remaining == 0)
+      pool->notify();
+  }
+
+}
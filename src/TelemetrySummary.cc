@@ -0,0 +1,64 @@
+#include <cp3_llbb/TTAnalysis/interface/TelemetrySummary.h>
+
+#include <algorithm>
+
+namespace TTAnalysis {
+
+  const size_t TelemetrySummary::Bins;
+  const size_t TelemetrySummary::Counts;
+
+  const std::array<const char*, TelemetrySummary::Counts> TelemetrySummary::s_names = {{
+#define TT_TELEMETRY(NAME, TYPE) #NAME,
+#include <cp3_llbb/TTAnalysis/interface/TelemetryList.h>
+#undef TT_TELEMETRY
+  }};
+
+  void TelemetrySummary::Distribution::add(uint32_t value) {
+    sum += value;
+    max = std::max(max, value);
+
+    // Bin 0 for 0, bin n for [2^(n-1), 2^n)
+    size_t bin = 0;
+    while(value && bin < Bins - 1){
+      value >>= 1;
+      bin++;
+    }
+    bins[bin]++;
+  }
+
+  void TelemetrySummary::add(const Telemetry& telemetry) {
+    m_events++;
+
+    size_t count = 0;
+#define TT_TELEMETRY(NAME, TYPE) m_distributions[count++].add(telemetry.NAME);
+#include <cp3_llbb/TTAnalysis/interface/TelemetryList.h>
+#undef TT_TELEMETRY
+  }
+
+  void TelemetrySummary::print(std::ostream& out) const {
+
+    out << "Telemetry summary (" << m_events << " events):" << std::endl;
+
+    for(size_t count = 0; count < Counts; count++){
+      const Distribution& distribution = m_distributions[count];
+
+      out << "\t" << s_names[count] << ": mean " << (m_events ? double(distribution.sum) / m_events : 0.) << ", max " << distribution.max << ", total " << distribution.sum << std::endl;
+      out << "\t\t";
+      for(size_t bin = 0; bin < Bins; bin++){
+        if(!distribution.bins[bin])
+          continue;
+
+        const uint32_t low = bin ? 1u << (bin - 1) : 0, high = (1u << bin) - 1;
+        if(bin == Bins - 1)
+          out << "[" << low << ", ...]";
+        else if(low == high)
+          out << "[" << low << "]";
+        else
+          out << "[" << low << ", " << high << "]";
+        out << ": " << distribution.bins[bin] << "  ";
+      }
+      out << std::endl;
+    }
+  }
+
+}
@@ -4,6 +4,8 @@
 
 namespace TTAnalysis {
   struct dictionary {
+    TTAnalysis::IndexPair<uint16_t> dummy0;
+    TTAnalysis::IndexPair<int16_t> dummy0b;
     TTAnalysis::BaseObject dummy;
     std::vector<TTAnalysis::BaseObject> dummy2;
     TTAnalysis::Lepton dummy3;
@@ -20,12 +22,21 @@ namespace TTAnalysis {
     std::vector<TTAnalysis::DiLepDiJetMet> dummy12;
     std::vector<uint16_t> dummy13;
     std::vector<std::vector<uint16_t>> dummy14;
+    std::vector<std::vector<uint8_t>> dummy14b;
     std::vector<float> dummy17;
     TTAnalysis::TTBar dummy18;
     std::vector<TTAnalysis::TTBar> dummy19;
     std::vector<std::vector<TTAnalysis::TTBar>> dummy20;
     std::vector<std::vector<std::vector<TTAnalysis::TTBar>>> dummy21;
+    TTAnalysis::TTBarCompact dummy21b;
+    std::vector<TTAnalysis::TTBarCompact> dummy21c;
+    std::vector<std::vector<TTAnalysis::TTBarCompact>> dummy21d;
+    std::vector<std::vector<std::vector<TTAnalysis::TTBarCompact>>> dummy21e;
+    TTAnalysis::TTBarSmeared dummy21f;
+    std::vector<TTAnalysis::TTBarSmeared> dummy21g;
+    std::vector<std::vector<TTAnalysis::TTBarSmeared>> dummy21h;
     TTAnalysis::GenParticle dummy22;
     std::vector<TTAnalysis::GenParticle> dummy23;
+    TTAnalysis::Telemetry dummy24;
   };
 }
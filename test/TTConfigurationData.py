@@ -42,6 +42,66 @@ framework.addAnalyzer('tt', cms.PSet(
 
             hltDRCut = cms.untracked.double(0.3), # DeltaR cut for trigger matching
             hltDPtCut = cms.untracked.double(0.5), #Delta(Pt)/Pt cut for trigger matching
+
+            preselectionMinLeptons = cms.untracked.uint32(0), # Skip the combinatorics for events with fewer selected leptons (0: disabled)
+            preselectionMinJets = cms.untracked.uint32(0), # Skip the combinatorics for events with fewer selected jets (0: disabled)
+
+            # Caps on the number of (di-lepton, di-jet) pairs of an event (0: disabled). Above them, the event is flagged in 'degraded' and
+            # all the lepton-jet combinatorics (maxDiLepDiJets), or only the ttbar reconstruction (ttbarMaxDiLepDiJets), is skipped
+            maxDiLepDiJets = cms.untracked.uint32(0),
+            ttbarMaxDiLepDiJets = cms.untracked.uint32(0),
+            # Number of candidates kept in each list of b-jet pairs (di-b-jets, di-lepton-di-b-jets, with or without MET), by decreasing
+            # CSVv2 or Pt (0: all of them). The ttbar system is only reconstructed for the kept candidates.
+            maxCandidatesPerCombination = cms.untracked.uint32(0),
+            # Number of largest events (by size of their outputs) reported at the end of the job, with the largest collections (0: not measured)
+            sizeReportEvents = cms.untracked.uint32(0),
+
+            # Branches, or groups of branches ('PtOrdered', 'DRCut', 'diLepDiJets', 'diLepDiJetsMet', 'gen_deltaR'), not written to the output
+            disabledBranches = cms.untracked.vstring(),
+
+            # Mantissa bits (out of 23) kept for the stored angular variables: smaller files for a relative precision of 2^-(bits+1)
+            DRMantissaBits = cms.untracked.uint32(23),
+            DEtaMantissaBits = cms.untracked.uint32(23),
+            DPhiMantissaBits = cms.untracked.uint32(23),
+
+            # Reject the configurations above the m_lb endpoint sqrt(mt^2 - mW^2) before solving: they cannot have a solution, and are
+            # flagged in 'ttbar_rejected' (same solutions, only disabled for validation)
+            neutrinosSolverPrecheck = cms.untracked.bool(True),
+            # Threads running the independent stages of an event (trigger and gen matching, ttbar reconstruction) concurrently,
+            # for each stream, besides its own (0: the stages run sequentially). The outputs do not depend on it.
+            stageThreads = cms.untracked.uint32(0),
+
+            # Number of ttbar solutions kept for each candidate, by increasing mtt (0: all of them)
+            ttbarMaxSolutions = cms.untracked.uint32(0),
+            # Resolution-smeared reconstruction, stored in 'ttbar_smeared': the energies of the leptons and b-jets and the MET are sampled
+            # within their resolutions, and the mtt of each candidate is averaged over the samples with a solution (0 samples: disabled)
+            ttbarSmearingSamples = cms.untracked.uint32(0),
+            ttbarSmearingLeptonResolution = cms.untracked.double(0.02), # Relative
+            ttbarSmearingJetResolution = cms.untracked.double(0.1), # Relative
+            ttbarSmearingMetResolution = cms.untracked.double(10), # GeV, for each component
+            ttbarSmearingSeed = cms.untracked.uint64(0), # Combined with the event numbers: the samples are reproducible
+            # Store the ttbar solutions as TTBarCompact (only the two tops) in `ttbar_compact` instead of `ttbar`
+            compactTTBar = cms.untracked.bool(False),
+
+            # Jet systematic variations computed by this analyzer, sharing the lepton, trigger and gen-level stages with the nominal jets.
+            # One PSet per variation: name (suffix of its jet-dependent branches), jetsProducer and optionally metProducer (default: the nominal one).
+            # Ex.: cms.PSet(name = cms.string('jecup'), jetsProducer = cms.string('jets_jecup'))
+            jetSystematics = cms.untracked.VPSet(),
+
+            # Also write the inputs of each event to this local binary file, to be replayed with 'ttReplay' ('': disabled)
+            captureFile = cms.untracked.string(''),
+
+            # Histograms filled directly by the analyzer for the nominal jets, written to 'histogramsFile' at the end of the job.
+            # One PSet per histogram: name, variable ('mll', 'nBJets', 'mjj', 'mlljj' or 'mtt'), bins, min, max, and the combinations to fill, named as in the branches.
+            # One histogram '<name>_<combination>_<flavour>' is filled per combination and flavour of the leading di-lepton.
+            # The outputs read by the histograms are computed even if their branches are disabled.
+            # Ex.: cms.PSet(name = cms.string('mtt'), variable = cms.string('mtt'), bins = cms.uint32(100), min = cms.double(0), max = cms.double(2000), combinations = cms.vstring('Lep_IDTT_IsoTT_BMM'))
+            histograms = cms.untracked.VPSet(),
+            histogramsFile = cms.untracked.string(''),
+            # Fill the histograms of simulated events with their generator weight, from the 'eventProducer' (negative for part of the
+            # events of NLO samples). Real data events have a weight of 1.
+            histogramsWeighted = cms.untracked.bool(True),
+            eventProducer = cms.untracked.string('event'),
             ),
         categories_parameters = cms.PSet(
             MllCutSF = cms.untracked.double(20),
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+
+/*
+ * Minimal checks for the unit tests of the library, which don't need the framework: each test is a program
+ * which reports the failed checks and exits with a non-zero code if any (see TT_TEST_RESULT).
+ */
+
+namespace TTAnalysis {
+  namespace Test {
+    inline size_t& failures() {
+      static size_t failures = 0;
+      return failures;
+    }
+  }
+}
+
+#define TT_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+      TTAnalysis::Test::failures()++; \
+    } \
+  } while (0)
+
+#define TT_TEST_RESULT() \
+  (TTAnalysis::Test::failures() ? (std::cerr << TTAnalysis::Test::failures() << " check(s) failed" << std::endl, 1) : 0)
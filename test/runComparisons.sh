@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Differential checks of the optimizations of the analysis, on captured events (see the analyzer `captureFile` parameter).
+#
+# Usage: runComparisons.sh capture.bin [capture2.bin ...]
+#
+# ttCompare must be in the PATH (after `scram b`). Each check runs ttCompare on the captures, and fails if an output differs
+# other than the expected ones. The telemetry summaries printed by ttCompare give the neutrinos solver calls of both sides.
+# To check the stage threads for races, run it with a ThreadSanitizer build:
+#   scram b USER_CXXFLAGS=-fsanitize=thread USER_LDFLAGS=-fsanitize=thread
+# The solver checks which don't need real events (pre-check, batch and mass hypotheses) are in testTTAnalysisNeutrinosSolver.
+
+if [ $# -eq 0 ]; then
+  echo "Usage: $0 capture.bin [capture2.bin ...]"
+  exit 1
+fi
+
+failed=0
+tab=$(printf '\t')
+
+# check "description" "outputs allowed to differ" ttCompare-options...
+check() {
+  description=$1
+  allowed=$2
+  shift 2
+
+  echo "=== ${description}: ttCompare $*"
+  report=$(ttCompare "$@" ${captures})
+  result=$?
+  echo "${report}"
+
+  if [ ${result} -eq 1 ]; then
+    echo "=== FAILED: ttCompare error"
+    failed=1
+    return
+  fi
+
+  # Outputs listed in the report as differing
+  for output in $(echo "${report}" | sed -n "s/^${tab}\([A-Za-z_]*\): [0-9]* events.*/\1/p"); do
+    case " ${allowed} " in
+      *" ${output} "*) ;;
+      *)
+        echo "=== FAILED: ${output} differs"
+        failed=1
+        ;;
+    esac
+  done
+}
+
+captures="$*"
+
+# Stages of each event run on a task pool: the outputs don't depend on the scheduling
+check "Stage threads" "" --candidate stageThreads=3
+
+# Kinematic pre-check of the neutrinos solver: same solutions. The rejected b-jet assignments are flagged in `ttbar_rejected`,
+# and counted in neutrinosRejected instead of neutrinosFailures.
+check "Solver pre-check" "telemetry ttbar_rejected" --reference neutrinosSolverPrecheck=0
+
+# Capped candidate lists: no change when the cap is above every list size, and fewer solver calls with a small cap
+check "Candidates cap above the list sizes" "" --candidate maxCandidatesPerCombination=65535
+check "One candidate per combination" "telemetry diBJets_DRCut_BWP_PtOrdered diBJets_DRCut_BWP_CSVv2Ordered diLepDiBJets_DRCut_BWP_PtOrdered diLepDiBJets_DRCut_BWP_CSVv2Ordered diLepDiBJetsMet_DRCut_BWP_PtOrdered diLepDiBJetsMet_DRCut_BWP_CSVv2Ordered ttbar ttbar_rejected ttbar_smeared" --candidate maxCandidatesPerCombination=1
+
+if [ ${failed} -ne 0 ]; then
+  echo "Some checks failed"
+  exit 1
+fi
+
+echo "All checks passed"
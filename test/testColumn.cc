@@ -0,0 +1,71 @@
+/*
+ * Column: views reference the bound array, owned columns hold their own copy, and copies keep the kind of their source.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/Column.h>
+
+#include "TestTools.h"
+
+#include <cstdint>
+
+using namespace TTAnalysis;
+
+int main() {
+
+  std::vector<float> array = { 1, 2, 3 };
+
+  // A view follows the elements of the bound array
+  Column<float> view;
+  view.bind(array);
+  TT_CHECK(view.size() == 3 && view.data() == array.data());
+  array[1] = 20;
+  TT_CHECK(view[1] == 20);
+
+  // Copying a view gives a view of the same array
+  Column<float> view_copy(view);
+  TT_CHECK(view_copy.data() == array.data());
+  Column<float> view_assigned;
+  view_assigned = view;
+  TT_CHECK(view_assigned.data() == array.data());
+
+  // An owned column holds its own copy of the elements
+  Column<float> owned;
+  owned.assign(array.begin(), array.end());
+  TT_CHECK(owned.size() == 3 && owned.data() != array.data());
+  array[0] = 10;
+  TT_CHECK(owned[0] == 1);
+
+  // A copy of an owned column owns another copy
+  Column<float> owned_copy(owned);
+  TT_CHECK(owned_copy.size() == 3 && owned_copy.data() != owned.data() && owned_copy[2] == 3);
+  owned.push_back(4);
+  TT_CHECK(owned.size() == 4 && owned_copy.size() == 3);
+
+  // Binding an array of another type converts it into the column's storage
+  const std::vector<bool> flags = { true, false, true };
+  Column<uint8_t> converted;
+  converted.bind(flags);
+  TT_CHECK(converted.size() == 3 && converted[0] == 1 && converted[1] == 0 && converted[2] == 1);
+
+  // Binding again replaces the elements, whatever the previous kind of the column
+  converted.bind(std::vector<bool>());
+  TT_CHECK(converted.empty());
+  owned.bind(array);
+  TT_CHECK(owned.data() == array.data());
+
+  // Swapping fills the column in place
+  std::vector<float> storage = { 5, 6 };
+  Column<float> swapped;
+  swapped.swap(storage);
+  TT_CHECK(swapped.size() == 2 && swapped[1] == 6 && storage.empty());
+
+  float sum = 0;
+  for (const float& value: swapped)
+    sum += value;
+  TT_CHECK(sum == 11);
+
+  swapped.clear();
+  TT_CHECK(swapped.empty() && swapped.begin() == swapped.end());
+
+  return TT_TEST_RESULT();
+}
@@ -0,0 +1,201 @@
+/*
+ * EventCapture: events written by EventCaptureWriter, also by several threads through a shared writer,
+ * are read back identical by EventCaptureReader.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/EventCapture.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include "TestTools.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+using namespace TTAnalysis;
+
+namespace {
+
+  myLorentzVector randomP4(RandomStream& random) {
+    return myLorentzVector(100 * random.uniform(), 5 * random.gaussian(), 3 * random.gaussian(), 200 * random.uniform());
+  }
+
+  template<typename T, typename Function>
+  void fillColumn(Column<T>& column, size_t size, Function function) {
+    std::vector<T> values;
+    for (size_t i = 0; i < size; i++)
+      values.push_back(function());
+    column.swap(values);
+  }
+
+  EventInputs randomEvent(RandomStream& random, uint64_t event) {
+    EventInputs inputs;
+    inputs.run = 1 + random.next() % 1000;
+    inputs.lumi = random.next() % 100;
+    inputs.event = event;
+    inputs.isRealData = random.next() % 2;
+
+    const size_t electrons = random.next() % 4, muons = random.next() % 4, jets = random.next() % 10;
+    fillColumn(inputs.electrons.p4, electrons, [&] { return randomP4(random); });
+    fillColumn(inputs.electrons.charge, electrons, [&] { return int8_t(random.next() % 2 ? 1 : -1); });
+    fillColumn(inputs.electrons.vetoID, electrons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.electrons.looseID, electrons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.electrons.mediumID, electrons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.electrons.tightID, electrons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.electrons.relativeIsoR03_withEA, electrons, [&] { return float(random.uniform()); });
+
+    fillColumn(inputs.muons.p4, muons, [&] { return randomP4(random); });
+    fillColumn(inputs.muons.charge, muons, [&] { return int8_t(random.next() % 2 ? 1 : -1); });
+    fillColumn(inputs.muons.isLoose, muons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.muons.isMedium, muons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.muons.isTight, muons, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.muons.relativeIsoR04_deltaBeta, muons, [&] { return float(random.uniform()); });
+
+    fillColumn(inputs.jets.p4, jets, [&] { return randomP4(random); });
+    fillColumn(inputs.jets.passLooseID, jets, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.jets.passTightID, jets, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.jets.passTightLeptonVetoID, jets, [&] { return uint8_t(random.next() % 2); });
+    fillColumn(inputs.jets.CSVv2, jets, [&] { return float(random.uniform()); });
+
+    inputs.met_p4 = randomP4(random);
+
+    inputs.hlt.exists = random.next() % 2;
+    const size_t paths = random.next() % 3, objects = random.next() % 4;
+    fillColumn(inputs.hlt.paths, paths, [&] { return "HLT_Path_v" + std::to_string(random.next() % 10); });
+    fillColumn(inputs.hlt.object_p4, objects, [&] { return randomP4(random); });
+    fillColumn(inputs.hlt.object_pdg_id, objects, [&] { return int32_t(random.next() % 30) - 15; });
+
+    if (!inputs.isRealData) {
+      const size_t particles = random.next() % 30;
+      fillColumn(inputs.genParticles.pruned_p4, particles, [&] { return randomP4(random); });
+      fillColumn(inputs.genParticles.pruned_pdg_id, particles, [&] { return int16_t(random.next() % 50) - 25; });
+      fillColumn(inputs.genParticles.pruned_status_flags, particles, [&] { return uint16_t(random.next()); });
+      fillColumn(inputs.genParticles.pruned_mothers_index, particles, [&] {
+        std::vector<uint16_t> mothers(random.next() % 3);
+        for (uint16_t& mother: mothers)
+          mother = random.next() % 40;
+        return mothers;
+      });
+    }
+
+    return inputs;
+  }
+
+  bool same(const myLorentzVector& a, const myLorentzVector& b) {
+    return a.Pt() == b.Pt() && a.Eta() == b.Eta() && a.Phi() == b.Phi() && a.E() == b.E();
+  }
+
+  template<typename T>
+  bool same(const T& a, const T& b) {
+    return a == b;
+  }
+
+  template<typename T>
+  bool same(const Column<T>& a, const Column<T>& b) {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); i++) {
+      if (!same(a[i], b[i]))
+        return false;
+    }
+    return true;
+  }
+
+  bool same(const EventInputs& a, const EventInputs& b) {
+    return a.run == b.run && a.lumi == b.lumi && a.event == b.event && a.isRealData == b.isRealData &&
+      same(a.electrons.p4, b.electrons.p4) && same(a.electrons.charge, b.electrons.charge) &&
+      same(a.electrons.vetoID, b.electrons.vetoID) && same(a.electrons.looseID, b.electrons.looseID) &&
+      same(a.electrons.mediumID, b.electrons.mediumID) && same(a.electrons.tightID, b.electrons.tightID) &&
+      same(a.electrons.relativeIsoR03_withEA, b.electrons.relativeIsoR03_withEA) &&
+      same(a.muons.p4, b.muons.p4) && same(a.muons.charge, b.muons.charge) &&
+      same(a.muons.isLoose, b.muons.isLoose) && same(a.muons.isMedium, b.muons.isMedium) && same(a.muons.isTight, b.muons.isTight) &&
+      same(a.muons.relativeIsoR04_deltaBeta, b.muons.relativeIsoR04_deltaBeta) &&
+      same(a.jets.p4, b.jets.p4) && same(a.jets.passLooseID, b.jets.passLooseID) && same(a.jets.passTightID, b.jets.passTightID) &&
+      same(a.jets.passTightLeptonVetoID, b.jets.passTightLeptonVetoID) && same(a.jets.CSVv2, b.jets.CSVv2) &&
+      same(a.met_p4, b.met_p4) &&
+      a.hlt.exists == b.hlt.exists && same(a.hlt.paths, b.hlt.paths) && same(a.hlt.object_p4, b.hlt.object_p4) &&
+      same(a.hlt.object_pdg_id, b.hlt.object_pdg_id) &&
+      same(a.genParticles.pruned_p4, b.genParticles.pruned_p4) && same(a.genParticles.pruned_pdg_id, b.genParticles.pruned_pdg_id) &&
+      same(a.genParticles.pruned_status_flags, b.genParticles.pruned_status_flags) &&
+      same(a.genParticles.pruned_mothers_index, b.genParticles.pruned_mothers_index);
+  }
+
+}
+
+int main() {
+
+  RandomStream random(RandomStream::seed({ 44, 3 }));
+  std::vector<EventInputs> events;
+  for (uint64_t event = 0; event < 500; event++)
+    events.push_back(randomEvent(random, event));
+
+  const std::string path = "testEventCapture.bin";
+
+  // Round trip, the inputs being reused by the reader as by the analyzer
+  {
+    EventCaptureWriter writer(path);
+    for (const EventInputs& inputs: events)
+      writer.write(inputs);
+    TT_CHECK(writer.events() == events.size());
+  }
+  {
+    EventCaptureReader reader(path);
+    EventInputs inputs;
+    size_t read = 0;
+    while (reader.read(inputs)) {
+      TT_CHECK(read < events.size() && same(inputs, events[read]));
+      read++;
+    }
+    TT_CHECK(read == events.size());
+  }
+
+  // Several threads writing through the shared writer: all the events are written, in any order
+  {
+    std::shared_ptr<EventCaptureWriter> writer = EventCaptureWriter::shared(path);
+    TT_CHECK(EventCaptureWriter::shared(path) == writer);
+
+    std::vector<std::thread> threads;
+    const size_t n_threads = 4;
+    for (size_t thread = 0; thread < n_threads; thread++) {
+      threads.emplace_back([&events, &path, thread, n_threads] {
+        std::shared_ptr<EventCaptureWriter> shared = EventCaptureWriter::shared(path);
+        for (size_t i = thread; i < events.size(); i += n_threads)
+          shared->write(events[i]);
+      });
+    }
+    for (std::thread& thread: threads)
+      thread.join();
+    TT_CHECK(writer->events() == events.size());
+  }
+  {
+    EventCaptureReader reader(path);
+    EventInputs inputs;
+    std::map<uint64_t, size_t> read;
+    while (reader.read(inputs)) {
+      TT_CHECK(inputs.event < events.size() && same(inputs, events[inputs.event]));
+      read[inputs.event]++;
+    }
+    TT_CHECK(read.size() == events.size());
+    for (const auto& count: read)
+      TT_CHECK(count.second == 1);
+  }
+
+  // Files which are not captures are rejected
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "not a capture";
+  }
+  bool thrown = false;
+  try {
+    EventCaptureReader reader(path);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  TT_CHECK(thrown);
+
+  std::remove(path.c_str());
+
+  return TT_TEST_RESULT();
+}
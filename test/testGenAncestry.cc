@@ -0,0 +1,82 @@
+/*
+ * GenAncestry::decaysFrom must agree with walking the first-mother chains by hand, on random decay forests
+ * including particles with several mothers, mothers out of range and broken (cyclic) chains.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/GenAncestry.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include "TestTools.h"
+
+using namespace TTAnalysis;
+
+namespace {
+
+  // First mother of `particle`, or -1 if it has none in the event
+  int32_t firstMother(const std::vector<std::vector<uint16_t>>& mothers, size_t particle) {
+    if (mothers[particle].empty() || mothers[particle][0] >= mothers.size())
+      return -1;
+    return mothers[particle][0];
+  }
+
+  // Reference: a particle decays from its first-mother ancestors, as long as its chain reaches a particle without mother
+  bool decaysFrom(const std::vector<std::vector<uint16_t>>& mothers, size_t particle, size_t mother) {
+    bool found = false;
+    int32_t current = particle;
+    for (size_t step = 0; step <= mothers.size(); step++) {
+      current = firstMother(mothers, current);
+      if (current < 0)
+        return found;
+      if (size_t(current) == mother)
+        found = true;
+    }
+    // Cyclic chain
+    return false;
+  }
+
+}
+
+int main() {
+
+  RandomStream random(RandomStream::seed({ 44, 1 }));
+  GenAncestry ancestry;
+
+  for (size_t event = 0; event < 200; event++) {
+    const size_t n = 1 + random.next() % 60;
+
+    std::vector<std::vector<uint16_t>> mothers(n);
+    for (size_t i = 0; i < n; i++) {
+      const uint64_t kind = random.next() % 20;
+      if (kind < 3)
+        continue; // No mother
+      else if (kind == 3)
+        mothers[i].push_back(n + random.next() % 5); // Out of range
+      else if (kind == 4)
+        mothers[i].push_back(random.next() % n); // Possibly a later particle, or itself: can make a cycle
+      else if (i > 0)
+        mothers[i].push_back(random.next() % i);
+
+      // Only the first mother is followed
+      if (random.next() % 4 == 0)
+        mothers[i].push_back(random.next() % n);
+    }
+
+    Column<std::vector<uint16_t>> column;
+    column.bind(mothers);
+    ancestry.build(column);
+
+    for (size_t particle = 0; particle < n; particle++) {
+      for (size_t mother = 0; mother < n; mother++)
+        TT_CHECK(ancestry.decaysFrom(particle, mother) == decaysFrom(mothers, particle, mother));
+    }
+
+    TT_CHECK(!ancestry.decaysFrom(n, 0));
+    TT_CHECK(!ancestry.decaysFrom(0, n));
+  }
+
+  // Empty event
+  ancestry.build(Column<std::vector<uint16_t>>());
+  TT_CHECK(!ancestry.decaysFrom(0, 0));
+
+  return TT_TEST_RESULT();
+}
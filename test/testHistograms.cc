@@ -0,0 +1,127 @@
+/*
+ * Histograms: binning of the filled values, merging of the histograms of several aggregators,
+ * filling from the outputs of an event, and the shared HistogramsFile written by the last of its users.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/Histograms.h>
+
+#include "TestTools.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+using namespace TTAnalysis;
+
+namespace {
+
+  template<typename Function>
+  bool throwsInvalidArgument(Function function) {
+    try {
+      function();
+    } catch (const std::invalid_argument&) {
+      return true;
+    }
+    return false;
+  }
+
+}
+
+int main() {
+
+  // Binning: underflow in bin 0, overflow (and NaN) in bin `bins() + 1`
+  Histogram histogram(4, 0, 100);
+  TT_CHECK(histogram.bins() == 4);
+  histogram.fill(-1);
+  histogram.fill(0);
+  histogram.fill(24.9, 2);
+  histogram.fill(25);
+  histogram.fill(99.9);
+  histogram.fill(100);
+  histogram.fill(std::numeric_limits<double>::quiet_NaN());
+  TT_CHECK(histogram.entries() == 7);
+  TT_CHECK(histogram.sumw(0) == 1);
+  TT_CHECK(histogram.sumw(1) == 3 && histogram.sumw2(1) == 5);
+  TT_CHECK(histogram.sumw(2) == 1);
+  TT_CHECK(histogram.sumw(3) == 0);
+  TT_CHECK(histogram.sumw(4) == 1);
+  TT_CHECK(histogram.sumw(5) == 2);
+
+  TT_CHECK(throwsInvalidArgument([] { Histogram(0, 0, 1); }));
+  TT_CHECK(throwsInvalidArgument([] { Histogram(10, 1, 1); }));
+
+  // Merging adds the contents of histograms with the same binning
+  Histogram other(4, 0, 100);
+  other.fill(10, 3);
+  histogram.merge(other);
+  TT_CHECK(histogram.entries() == 8 && histogram.sumw(1) == 6 && histogram.sumw2(1) == 14);
+  TT_CHECK(throwsInvalidArgument([&histogram] { histogram.merge(Histogram(4, 0, 200)); }));
+
+  // Negative weights (part of the events of NLO samples) are subtracted from the contents, and added to the variances
+  Histogram weighted(1, 0, 1);
+  weighted.fill(0.5, 2);
+  weighted.fill(0.5, -1);
+  TT_CHECK(weighted.entries() == 2 && weighted.sumw(1) == 1 && weighted.sumw2(1) == 5);
+
+  // Aggregator: one histogram per combination and flavour of the leading DiLepton
+  const std::string mll_combination = LepLepIDIsoStr(LepID::T, LepIso::T, LepID::T, LepIso::T);
+  const std::string nbjets_combination = LepIDIsoJetBWPStr(LepID::T, LepIso::T, BWP::M);
+  const std::vector<HistogramConfig> configs = {
+    { "mll", HistogramVariable::Mll, 10, 0, 200, { mll_combination } },
+    { "nb", HistogramVariable::NBJets, 5, 0, 5, { nbjets_combination } }
+  };
+
+  HistogramAggregator aggregator(configs);
+  TT_CHECK(aggregator.histograms().size() == 2 * DiLepFlavour::Count);
+  TT_CHECK(aggregator.names()[0] == "mll_" + mll_combination + "_" + DiLepFlavour::map.at(DiLepFlavour::ElEl));
+
+  TT_CHECK(throwsInvalidArgument([] { HistogramAggregator({ { "mll", HistogramVariable::Mll, 10, 0, 200, { "unknown" } } }); }));
+  TT_CHECK(throwsInvalidArgument([&] { HistogramAggregator({ { "nb", HistogramVariable::NBJets, 5, 0, 5, { mll_combination } } }); }));
+
+  const std::set<std::string> required = HistogramAggregator::requiredOutputs(configs);
+  TT_CHECK(required.size() == 1 && required.count("selBJets_DRCut_BWP_CSVv2Ordered"));
+
+  // An event with a leading MuMu DiLepton and two b-jets
+  EventOutputs outputs;
+  const uint16_t diLepton = LepLepIDIso(LepID::T, LepIso::T, LepID::T, LepIso::T);
+  outputs.diLeptons_summary[diLepton].diLepIdx = 0;
+  outputs.diLeptons_summary[diLepton].flavour = DiLepFlavour::MuMu;
+  outputs.diLeptons_summary[diLepton].Mll = 91;
+  outputs.selBJets_DRCut_BWP_CSVv2Ordered.resize(LepID::Count * LepIso::Count * BWP::Count);
+  outputs.selBJets_DRCut_BWP_CSVv2Ordered[LepIDIsoJetBWP(LepID::T, LepIso::T, BWP::M)] = { 0, 1 };
+
+  aggregator.fill(outputs);
+  const Histogram& mll = aggregator.histograms()[DiLepFlavour::MuMu];
+  const Histogram& nb = aggregator.histograms()[DiLepFlavour::Count + DiLepFlavour::MuMu];
+  TT_CHECK(mll.entries() == 1 && mll.sumw(5) == 1);
+  TT_CHECK(nb.entries() == 1 && nb.sumw(3) == 1);
+  TT_CHECK(aggregator.histograms()[DiLepFlavour::ElEl].entries() == 0);
+
+  // Events without leading DiLepton are not counted
+  outputs.diLeptons_summary[diLepton].diLepIdx = -1;
+  aggregator.fill(outputs);
+  TT_CHECK(mll.entries() == 1);
+
+  HistogramAggregator second(configs);
+  outputs.diLeptons_summary[diLepton].diLepIdx = 0;
+  second.fill(outputs, 2);
+  aggregator.merge(second);
+  TT_CHECK(mll.entries() == 2 && mll.sumw(5) == 3 && mll.sumw2(5) == 5);
+  TT_CHECK(throwsInvalidArgument([&aggregator] { aggregator.merge(HistogramAggregator({})); }));
+
+  // Shared file: merged, and written once by its last user
+  const std::string path = "testHistograms.root";
+  {
+    std::shared_ptr<HistogramsFile> file1 = HistogramsFile::open(path);
+    std::shared_ptr<HistogramsFile> file2 = HistogramsFile::open(path);
+    TT_CHECK(file1 == file2);
+    TT_CHECK(HistogramsFile::open("other.root") != file1);
+
+    TT_CHECK(!file1->add(aggregator));
+    TT_CHECK(file2->add(second));
+  }
+  std::remove(path.c_str());
+
+  return TT_TEST_RESULT();
+}
@@ -0,0 +1,206 @@
+/*
+ * NeutrinosSolver on generated dileptonic ttbar configurations, with and without resolution effects, and random ones:
+ * - the kinematic pre-check (see NeutrinosSolver::AboveMlbEndpoint) must not change the solutions,
+ * - the batch and multi-hypothesis calls must give the same solutions as the single-configuration calls.
+ * The time taken by the multi-hypothesis call and by separate solvers is also reported.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/NeutrinosSolver.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include "TestTools.h"
+
+#include <chrono>
+#include <cmath>
+
+using namespace TTAnalysis;
+
+using LorentzVector = NeutrinosSolver::LorentzVector;
+
+namespace {
+
+  const double TOP_MASS = 172.5, W_MASS = 80.4, B_MASS = 4.8;
+
+  LorentzVector fromMass(double px, double py, double pz, double mass) {
+    return LorentzVector(px, py, pz, std::sqrt(px * px + py * py + pz * pz + mass * mass));
+  }
+
+  LorentzVector randomMomentum(RandomStream& random, double scale, double mass) {
+    return fromMass(scale * random.gaussian(), scale * random.gaussian(), 2 * scale * random.gaussian(), mass);
+  }
+
+  // Isotropic two-body decay of `parent` into masses m1 and m2, the first daughter being returned
+  LorentzVector decay(RandomStream& random, const LorentzVector& parent, double m1, double m2, LorentzVector& second) {
+    const double M = parent.M();
+    const double p = std::sqrt((M * M - (m1 + m2) * (m1 + m2)) * (M * M - (m1 - m2) * (m1 - m2))) / (2 * M);
+    const double cos_theta = 2 * random.uniform() - 1;
+    const double sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+    const double phi = 2 * M_PI * random.uniform();
+    const double rest[3] = { p * sin_theta * std::cos(phi), p * sin_theta * std::sin(phi), p * cos_theta };
+
+    // Boost to the frame of `parent`
+    const double beta[3] = { parent.Px() / parent.E(), parent.Py() / parent.E(), parent.Pz() / parent.E() };
+    const double beta2 = beta[0] * beta[0] + beta[1] * beta[1] + beta[2] * beta[2];
+    const double gamma = 1 / std::sqrt(1 - beta2);
+
+    auto boost = [&](const double momentum[3], double energy) {
+      const double beta_p = beta[0] * momentum[0] + beta[1] * momentum[1] + beta[2] * momentum[2];
+      const double factor = beta2 > 0 ? (gamma - 1) * beta_p / beta2 + gamma * energy : 0;
+      return LorentzVector(momentum[0] + factor * beta[0], momentum[1] + factor * beta[1], momentum[2] + factor * beta[2], gamma * (energy + beta_p));
+    };
+
+    const double opposite[3] = { -rest[0], -rest[1], -rest[2] };
+    second = boost(opposite, std::sqrt(p * p + m2 * m2));
+    return boost(rest, std::sqrt(p * p + m1 * m1));
+  }
+
+  bool sameSolutions(const std::vector<std::pair<LorentzVector, LorentzVector>>& a, const std::vector<std::pair<LorentzVector, LorentzVector>>& b) {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); i++) {
+      if (a[i].first.Px() != b[i].first.Px() || a[i].first.Pz() != b[i].first.Pz() || a[i].first.E() != b[i].first.E() ||
+          a[i].second.Px() != b[i].second.Px() || a[i].second.Pz() != b[i].second.Pz() || a[i].second.E() != b[i].second.E())
+        return false;
+    }
+    return true;
+  }
+
+  // The m_lb endpoint of the nominal masses, with some tolerance on the rounding errors of the solver
+  bool aboveMlbEndpoint(const LorentzVector& lepton, const LorentzVector& bjet) {
+    return bjet.M2() >= 0 && (lepton + bjet).M2() - lepton.M2() > (TOP_MASS * TOP_MASS - W_MASS * W_MASS) * (1 - 1e-6);
+  }
+
+  // Solutions of one entry of a SolutionTable
+  bool sameSolutions(const std::vector<std::pair<LorentzVector, LorentzVector>>& a, const NeutrinosSolver::SolutionTable& table, size_t entry) {
+    std::vector<std::pair<LorentzVector, LorentzVector>> b;
+    for (size_t i = 0; i < table.solutions(entry); i++)
+      b.push_back(table.solution(entry, i));
+    return sameSolutions(a, b);
+  }
+
+}
+
+int main() {
+
+  const NeutrinosSolver checked(TOP_MASS, W_MASS, true);
+  const NeutrinosSolver unchecked(TOP_MASS, W_MASS, false);
+
+  RandomStream random(RandomStream::seed({ 32 }));
+
+  size_t solved = 0, rejected = 0, true_solved = 0;
+  const size_t n_configurations = 30000;
+  std::vector<NeutrinosSolver::Configuration> configurations;
+
+  for (size_t i = 0; i < n_configurations; i++) {
+    LorentzVector l1, l2, b1, b2, met;
+
+    const int kind = i % 3; // 0: generated, 1: generated with resolution effects, 2: random objects
+    if (kind < 2) {
+      LorentzVector t1 = randomMomentum(random, 80, TOP_MASS), t2 = randomMomentum(random, 80, TOP_MASS);
+      LorentzVector w1, w2, nu1, nu2;
+      b1 = decay(random, t1, B_MASS, W_MASS, w1);
+      b2 = decay(random, t2, B_MASS, W_MASS, w2);
+      l1 = decay(random, w1, 0, 0, nu1);
+      l2 = decay(random, w2, 0, 0, nu2);
+      met = nu1 + nu2;
+      met.SetPxPyPzE(met.Px(), met.Py(), 0, std::hypot(met.Px(), met.Py()));
+
+      if (kind == 1) {
+        b1 = b1 * std::max(1 + 0.1 * random.gaussian(), 0.1);
+        b2 = b2 * std::max(1 + 0.1 * random.gaussian(), 0.1);
+        const double met_x = met.Px() + 15 * random.gaussian(), met_y = met.Py() + 15 * random.gaussian();
+        met.SetPxPyPzE(met_x, met_y, 0, std::hypot(met_x, met_y));
+      }
+    } else {
+      l1 = randomMomentum(random, 60, 0);
+      l2 = randomMomentum(random, 60, 0);
+      b1 = randomMomentum(random, 80, B_MASS);
+      b2 = randomMomentum(random, 80, B_MASS);
+      met = randomMomentum(random, 60, 0);
+      met.SetPxPyPzE(met.Px(), met.Py(), 0, std::hypot(met.Px(), met.Py()));
+    }
+
+    configurations.push_back({ l1, l2, b1, b2, met });
+
+    NeutrinosSolver::Status checked_status, unchecked_status;
+    const auto checked_solutions = checked.getNeutrinos(l1, l2, b1, b2, met, checked_status);
+    const auto unchecked_solutions = unchecked.getNeutrinos(l1, l2, b1, b2, met, unchecked_status);
+
+    TT_CHECK(sameSolutions(checked_solutions, unchecked_solutions));
+    TT_CHECK(unchecked_status != NeutrinosSolver::AboveMlbEndpoint);
+
+    if (checked_status == NeutrinosSolver::AboveMlbEndpoint) {
+      rejected++;
+      TT_CHECK(unchecked_solutions.empty());
+      TT_CHECK(aboveMlbEndpoint(l1, b1) || aboveMlbEndpoint(l2, b2));
+    } else {
+      TT_CHECK(checked_status == unchecked_status);
+    }
+
+    if (!checked_solutions.empty()) {
+      solved++;
+      if (kind == 0)
+        true_solved++;
+    }
+  }
+
+  // The generated configurations have their true solution, and a part of the others is rejected
+  TT_CHECK(true_solved > 0.95 * n_configurations / 3);
+  TT_CHECK(rejected > 0);
+
+  std::cout << n_configurations << " configurations: " << solved << " solved, " << rejected << " rejected by the pre-check" << std::endl;
+
+  // Batch of configurations: same as solving them one by one. Timed once the table has its allocations, as when it is reused.
+  NeutrinosSolver::SolutionTable table;
+  checked.getNeutrinos(configurations, table);
+  auto start = std::chrono::steady_clock::now();
+  checked.getNeutrinos(configurations, table);
+  const std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - start;
+
+  std::chrono::duration<double> single_time(0);
+  TT_CHECK(table.size() == configurations.size());
+  for (size_t i = 0; i < configurations.size(); i++) {
+    const NeutrinosSolver::Configuration& c = configurations[i];
+    NeutrinosSolver::Status status;
+    start = std::chrono::steady_clock::now();
+    const auto solutions = checked.getNeutrinos(c.lepton1_p4, c.lepton2_p4, c.bjet1_p4, c.bjet2_p4, c.met, status);
+    single_time += std::chrono::steady_clock::now() - start;
+
+    TT_CHECK(table.status(i) == status);
+    TT_CHECK(sameSolutions(solutions, table, i));
+  }
+
+  std::cout << "Batch of " << configurations.size() << " configurations: " << single_time.count() << " s one by one, "
+    << batch_time.count() << " s with the batch call" << std::endl;
+
+  // Mass hypotheses: same as one solver per hypothesis
+  std::vector<NeutrinosSolver::MassHypothesis> hypotheses;
+  std::vector<NeutrinosSolver> solvers;
+  for (int i = -5; i <= 5; i++) {
+    hypotheses.push_back({ float(TOP_MASS + i), float(W_MASS) });
+    solvers.push_back(NeutrinosSolver(TOP_MASS + i, W_MASS));
+  }
+
+  std::chrono::duration<double> separate_time(0), hypotheses_time(0);
+  for (const NeutrinosSolver::Configuration& c: configurations) {
+    start = std::chrono::steady_clock::now();
+    checked.getNeutrinos(c.lepton1_p4, c.lepton2_p4, c.bjet1_p4, c.bjet2_p4, c.met, hypotheses, table);
+    hypotheses_time += std::chrono::steady_clock::now() - start;
+
+    TT_CHECK(table.size() == hypotheses.size());
+    for (size_t h = 0; h < hypotheses.size(); h++) {
+      NeutrinosSolver::Status status;
+      start = std::chrono::steady_clock::now();
+      const auto solutions = solvers[h].getNeutrinos(c.lepton1_p4, c.lepton2_p4, c.bjet1_p4, c.bjet2_p4, c.met, status);
+      separate_time += std::chrono::steady_clock::now() - start;
+
+      TT_CHECK(table.status(h) == status);
+      TT_CHECK(sameSolutions(solutions, table, h));
+    }
+  }
+
+  std::cout << hypotheses.size() << " mass hypotheses: " << separate_time.count() << " s with separate solvers, "
+    << hypotheses_time.count() << " s with the multi-hypothesis call" << std::endl;
+
+  return TT_TEST_RESULT();
+}
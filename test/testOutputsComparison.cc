@@ -0,0 +1,121 @@
+/*
+ * OutputsComparison: identical outputs agree, floating-point values agree within the tolerance,
+ * integers and index lists must be identical, and the ttbar solutions of a candidate are matched up to their ordering.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/OutputsComparison.h>
+
+#include "TestTools.h"
+
+#include <sstream>
+
+using namespace TTAnalysis;
+
+namespace {
+
+  EventOutputs referenceOutputs() {
+    EventOutputs outputs;
+
+    Lepton lepton;
+    lepton.p4 = myLorentzVector(50, 1.2, -0.5, 100);
+    lepton.idx = 1;
+    lepton.charge = -1;
+    lepton.hlt_idx = -1;
+    outputs.leptons.push_back(lepton);
+    lepton.p4 = myLorentzVector(30, -0.3, 3.1, 40);
+    lepton.idx = 0;
+    lepton.charge = 1;
+    outputs.leptons.push_back(lepton);
+
+    outputs.leptons_IDIso = { { 0, 1 }, { 1 } };
+
+    const myLorentzVector top1(120, 0.5, 1, 300), top2(80, -1, -2, 250), top3(60, 2, 0.1, 600);
+    outputs.ttbar = { { { TTBar(0, top1, top2), TTBar(0, top2, top3), TTBar(0, top1, top3) } } };
+
+    return outputs;
+  }
+
+}
+
+int main() {
+
+  const EventOutputs reference = referenceOutputs();
+
+  // Identical outputs
+  {
+    OutputsComparison comparison;
+    TT_CHECK(comparison.compare(1, 1, 1, reference, reference) == 0);
+    TT_CHECK(comparison.identical());
+  }
+
+  // Four-vectors within the tolerance, and Phi compared as an angle
+  {
+    EventOutputs candidate = reference;
+    candidate.leptons[0].p4 = myLorentzVector(50 * (1 + 1e-7), 1.2, -0.5, 100);
+    candidate.leptons[1].p4 = myLorentzVector(30, -0.3, 3.1 - 2 * M_PI, 40);
+
+    OutputsComparison comparison;
+    TT_CHECK(comparison.compare(1, 1, 1, reference, candidate) == 0);
+  }
+
+  // Beyond the tolerance
+  {
+    EventOutputs candidate = reference;
+    candidate.leptons[0].p4 = myLorentzVector(50 * (1 + 1e-3), 1.2, -0.5, 100);
+
+    OutputsComparison comparison;
+    TT_CHECK(comparison.compare(1, 1, 1, reference, candidate) == 1);
+    TT_CHECK(!comparison.identical());
+
+    // The report names the output and the field
+    std::ostringstream report;
+    comparison.report(report);
+    TT_CHECK(report.str().find("1 of 1 events differ") != std::string::npos);
+    TT_CHECK(report.str().find("1:1:1 leptons[0].p4.Pt") != std::string::npos);
+
+    OutputsComparison loose(1e-2);
+    TT_CHECK(loose.compare(1, 1, 1, reference, candidate) == 0);
+  }
+
+  // Integers and index lists must be identical
+  {
+    EventOutputs candidate = reference;
+    candidate.leptons[1].idx = 2;
+    candidate.leptons_IDIso[1].push_back(0);
+
+    OutputsComparison comparison;
+    TT_CHECK(comparison.compare(1, 1, 1, reference, candidate) == 2);
+  }
+
+  // The ttbar solutions of a candidate are compared up to their ordering, but not their number
+  {
+    EventOutputs candidate = reference;
+    std::vector<TTBar>& solutions = candidate.ttbar[0][0];
+    std::swap(solutions[0], solutions[2]);
+    std::swap(solutions[1], solutions[2]);
+
+    OutputsComparison comparison;
+    TT_CHECK(comparison.compare(1, 1, 1, reference, candidate) == 0);
+
+    solutions.pop_back();
+    TT_CHECK(comparison.compare(1, 1, 2, reference, candidate) == 1);
+  }
+
+  // The first `examples` differences are kept for the report, all of them are counted
+  {
+    EventOutputs candidate = reference;
+    for (Lepton& lepton: candidate.leptons)
+      lepton.charge = -lepton.charge;
+
+    OutputsComparison comparison(1e-5, 1);
+    for (uint64_t event = 0; event < 3; event++)
+      TT_CHECK(comparison.compare(1, 1, event, reference, candidate) == 2);
+
+    std::ostringstream report;
+    comparison.report(report);
+    TT_CHECK(report.str().find("leptons: 3 events, 6 fields") != std::string::npos);
+    TT_CHECK(report.str().find("1:1:1 ") == std::string::npos);
+  }
+
+  return TT_TEST_RESULT();
+}
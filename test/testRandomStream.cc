@@ -0,0 +1,65 @@
+/*
+ * RandomStream: the sequences only depend on the seed, the seeds on the order of the combined numbers,
+ * and the uniform and Gaussian numbers have the expected ranges and moments.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include "TestTools.h"
+
+#include <cmath>
+
+using namespace TTAnalysis;
+
+int main() {
+
+  // Same seed, same sequence
+  RandomStream a(RandomStream::seed({ 1, 2, 3 })), b(RandomStream::seed({ 1, 2, 3 }));
+  for (size_t i = 0; i < 1000; i++)
+    TT_CHECK(a.next() == b.next());
+
+  // The seed depends on all the numbers and on their order
+  TT_CHECK(RandomStream::seed({ 1, 2, 3 }) != RandomStream::seed({ 3, 2, 1 }));
+  TT_CHECK(RandomStream::seed({ 1, 2, 3 }) != RandomStream::seed({ 1, 2, 4 }));
+  TT_CHECK(RandomStream::seed({ 1, 2 }) != RandomStream::seed({ 1, 2, 0 }));
+  TT_CHECK(RandomStream::seed({ 0 }) != RandomStream::seed({}));
+
+  // Fixed sequence: the numbers must not depend on the platform or standard library
+  RandomStream fixed(0);
+  TT_CHECK(fixed.next() == 0xe220a8397b1dcdafULL);
+  TT_CHECK(fixed.next() == 0x6e789e6aa1b965f4ULL);
+
+  RandomStream random(RandomStream::seed({ 44, 2 }));
+  const size_t n = 200000;
+
+  double sum = 0, sum2 = 0;
+  double min = 1, max = 0;
+  for (size_t i = 0; i < n; i++) {
+    const double value = random.uniform();
+    TT_CHECK(value > 0 && value <= 1);
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sum += value;
+    sum2 += value * value;
+  }
+  TT_CHECK(std::abs(sum / n - 0.5) < 0.005);
+  TT_CHECK(std::abs(sum2 / n - sum * sum / n / n - 1. / 12) < 0.002);
+  TT_CHECK(min < 0.001 && max > 0.999);
+
+  sum = 0;
+  sum2 = 0;
+  size_t beyond_2_sigma = 0;
+  for (size_t i = 0; i < n; i++) {
+    const double value = random.gaussian();
+    TT_CHECK(std::isfinite(value));
+    sum += value;
+    sum2 += value * value;
+    if (std::abs(value) > 2)
+      beyond_2_sigma++;
+  }
+  TT_CHECK(std::abs(sum / n) < 0.01);
+  TT_CHECK(std::abs(sum2 / n - 1) < 0.02);
+  TT_CHECK(std::abs(double(beyond_2_sigma) / n - 0.0455) < 0.003);
+
+  return TT_TEST_RESULT();
+}
@@ -0,0 +1,138 @@
+/*
+ * TaskGraph: the stages run once each, after all their dependencies, sequentially or on TaskPools of several sizes,
+ * and the first exception thrown by a stage is rethrown by run(). A TaskPool also runs jobs submitted from outside its workers.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/TaskGraph.h>
+
+#include "TestTools.h"
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace TTAnalysis;
+
+namespace {
+
+  const size_t STAGES = 12;
+
+  struct Trace {
+    std::atomic<size_t> clock{0};
+    std::atomic<size_t> runs[STAGES];
+    std::atomic<size_t> started[STAGES];
+    std::atomic<size_t> finished[STAGES];
+
+    void reset() {
+      clock = 0;
+      for (size_t stage = 0; stage < STAGES; stage++) {
+        runs[stage] = 0;
+        started[stage] = 0;
+        finished[stage] = 0;
+      }
+    }
+  };
+
+}
+
+int main() {
+
+  // Dependencies of each stage: two diamonds joined by a chain, and independent stages
+  const std::vector<std::vector<size_t>> dependencies = {
+    {}, {0}, {0}, {1, 2}, {3}, {4}, {4}, {5, 6}, {}, {8}, {}, {3, 7, 9, 10}
+  };
+
+  Trace trace;
+  TaskGraph graph;
+  for (size_t stage = 0; stage < STAGES; stage++) {
+    auto function = [&trace, stage] {
+      trace.runs[stage]++;
+      trace.started[stage] = ++trace.clock;
+      // Some work, for the other stages to run concurrently
+      volatile double sum = 0;
+      for (size_t i = 0; i < 10000; i++)
+        sum = sum + i;
+      trace.finished[stage] = ++trace.clock;
+    };
+
+    const std::vector<size_t>& deps = dependencies[stage];
+    if (deps.empty())
+      graph.add(function);
+    else if (deps.size() == 1)
+      graph.add(function, {deps[0]});
+    else if (deps.size() == 2)
+      graph.add(function, {deps[0], deps[1]});
+    else
+      graph.add(function, {deps[0], deps[1], deps[2], deps[3]});
+  }
+
+  // A stage can only depend on the stages added before it
+  bool thrown = false;
+  try {
+    TaskGraph invalid;
+    invalid.add([] {}, {0});
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  TT_CHECK(thrown);
+
+  for (size_t threads: {0, 1, 2, 4}) {
+    TaskPool pool(threads);
+    TT_CHECK(pool.threads() == threads);
+
+    for (size_t run = 0; run < 50; run++) {
+      trace.reset();
+      graph.run(&pool);
+
+      for (size_t stage = 0; stage < STAGES; stage++) {
+        TT_CHECK(trace.runs[stage] == 1);
+        for (const size_t& dependency: dependencies[stage])
+          TT_CHECK(trace.finished[dependency] < trace.started[stage]);
+      }
+    }
+  }
+
+  // Sequential run without pool: in the order of addition
+  trace.reset();
+  graph.run(nullptr);
+  for (size_t stage = 1; stage < STAGES; stage++)
+    TT_CHECK(trace.finished[stage - 1] < trace.started[stage]);
+
+  // The first exception is rethrown, and the dependents of the failed stage are skipped
+  for (size_t threads: {0, 3}) {
+    TaskPool pool(threads);
+    std::atomic<size_t> after{0};
+
+    TaskGraph failing;
+    const TaskGraph::Stage first = failing.add([] {});
+    const TaskGraph::Stage throwing = failing.add([] { throw std::runtime_error("stage failed"); }, {first});
+    failing.add([&after] { after++; }, {throwing});
+
+    for (size_t run = 0; run < 10; run++) {
+      thrown = false;
+      try {
+        failing.run(&pool);
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      TT_CHECK(thrown);
+    }
+    TT_CHECK(after == 0);
+  }
+
+  // Jobs submitted from outside the workers
+  {
+    TaskPool pool(3);
+    std::atomic<size_t> done{0};
+    const size_t jobs = 1000;
+    for (size_t job = 0; job < jobs; job++) {
+      pool.submit([&pool, &done] {
+        if (++done == jobs)
+          pool.notify();
+      });
+    }
+    pool.runUntil([&done] { return done == jobs; });
+    TT_CHECK(done == jobs);
+  }
+
+  return TT_TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+/*
+ * Tools.h helpers: truncateMantissa rounds to the nearest value with the requested precision,
+ * and leaves the special values (and those which would round up to infinity) unchanged.
+ * sortCandidates breaks the ties by index, so that a capped list is the beginning of the full one.
+ */
+
+#include <cp3_llbb/TTAnalysis/interface/Tools.h>
+#include <cp3_llbb/TTAnalysis/interface/RandomStream.h>
+
+#include "TestTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+using namespace TTAnalysis;
+
+int main() {
+
+  // Exactly representable values are unchanged
+  TT_CHECK(truncateMantissa(0.f, 7) == 0.f);
+  TT_CHECK(truncateMantissa(1.f, 7) == 1.f);
+  TT_CHECK(truncateMantissa(-1.5f, 1) == -1.5f);
+  TT_CHECK(truncateMantissa(3.f, 1) == 3.f);
+
+  // Round to nearest
+  TT_CHECK(truncateMantissa(1.2f, 1) == 1.f);
+  TT_CHECK(truncateMantissa(1.3f, 1) == 1.5f);
+  TT_CHECK(truncateMantissa(1.9f, 1) == 2.f);
+  TT_CHECK(truncateMantissa(-1.9f, 1) == -2.f);
+
+  // Special values, and all the bits kept
+  const float max = std::numeric_limits<float>::max();
+  const float infinity = std::numeric_limits<float>::infinity();
+  TT_CHECK(truncateMantissa(max, 7) == max);
+  TT_CHECK(truncateMantissa(-max, 7) == -max);
+  TT_CHECK(truncateMantissa(infinity, 7) == infinity);
+  TT_CHECK(std::isnan(truncateMantissa(std::numeric_limits<float>::quiet_NaN(), 7)));
+  TT_CHECK(truncateMantissa(0.1f, 23) == 0.1f);
+
+  // Relative precision of 2^-(bits+1), and the dropped bits are zero
+  RandomStream random(RandomStream::seed({ 44, 4 }));
+  for (size_t i = 0; i < 100000; i++) {
+    const float value = std::ldexp(2 * random.uniform() - 1, int(random.next() % 40) - 20);
+    const uint8_t bits = random.next() % 23;
+    const float truncated = truncateMantissa(value, bits);
+
+    TT_CHECK(std::abs(truncated - value) <= std::ldexp(std::abs(value), -(bits + 1)));
+
+    uint32_t word;
+    std::memcpy(&word, &truncated, sizeof(word));
+    TT_CHECK((word & ((1u << (23 - bits)) - 1)) == 0);
+  }
+
+  // Sorted by a key with many ties, uncapped and capped
+  for (size_t size: { 5, 16, 17, 100 }) {
+    std::vector<int> keys(size);
+    for (int& key: keys)
+      key = random.next() % 4;
+    auto sorter = [&keys](uint16_t a, uint16_t b) { return keys[a] > keys[b]; };
+
+    std::vector<uint16_t> all(size);
+    std::iota(all.begin(), all.end(), 0);
+    sortCandidates(all, 0, sorter);
+    for (size_t i = 1; i < size; i++)
+      TT_CHECK(keys[all[i - 1]] > keys[all[i]] || (keys[all[i - 1]] == keys[all[i]] && all[i - 1] < all[i]));
+
+    for (size_t max: { size_t(1), size / 2, size, size_t(65535) }) {
+      std::vector<uint16_t> capped(size);
+      std::iota(capped.begin(), capped.end(), 0);
+      sortCandidates(capped, max, sorter);
+      TT_CHECK(capped.size() == std::min(size, max));
+      TT_CHECK(std::equal(capped.begin(), capped.end(), all.begin()));
+    }
+  }
+
+  return TT_TEST_RESULT();
+}